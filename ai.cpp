@@ -0,0 +1,232 @@
+#include "ai.hpp"
+#include "replay.hpp"
+#include <sys/time.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+
+// Score of a placement that ends the game
+#define LOSING_SCORE -1e9
+
+// Games run for balancing stop here if the bot is still going
+#define AUTOPLAY_MAX_TICKS 20000
+
+// Shortest time between ticks at the fastest speed, in milliseconds.
+// Choosing a move has to take less than this.
+#define FASTEST_TICK 50
+
+// The bot remembers the scores of 2^AI_TABLE_BITS games
+#define AI_TABLE_BITS 16
+
+AiWeights::AiWeights()
+	: squares(10)
+	, sweep(4)
+	, adjacency(1.5)
+	, height(1)
+	, danger(0.25)
+	, bumpiness(0.5)
+{
+}
+
+AiPlayer::AiPlayer(int newBeamWidth, int threads)
+	: beamWidth(std::max(newBeamWidth, 1))
+	, pool(threads)
+	, seen(AI_TABLE_BITS)
+	, game(NULL)
+	, games(pool.size())
+	, second(pool.size() * MAX_PLACEMENTS)
+{
+}
+
+const AiWeights &AiPlayer::getWeights() const
+{
+	return weights;
+}
+
+void AiPlayer::setWeights(const AiWeights &newWeights)
+{
+	// Everything remembered was scored the old way
+	weights = newWeights;
+	seen.clear();
+}
+
+// Colour of the board at (r, c) with the placement made, or -1 if it is
+// one of the piece's own cells or off the board
+static int neighbourColour(const Game &game, const Placement &placement, int r, int c)
+{
+	if (r < 0 || r >= game.getHeight() + 4 || c < 0 || c >= game.getWidth())
+		return -1;
+	for (int k = 0;k<4;k++)
+		if (placement.cellRow[k] == r && placement.cellCol[k] == c)
+			return -1;
+	return game.get(r, c);
+}
+
+double AiPlayer::evaluate(const Game &game, const Placement &placement) const
+{
+	if (placement.gameOver)
+		return LOSING_SCORE;
+
+	int width = game.getWidth();
+	int heights[32];
+	for (int c = 0;c<width;c++)
+		heights[c] = game.getColumnHeight(c);
+	heights[placement.x + 1] = placement.landingRow[0];
+	heights[placement.x + 2] = placement.landingRow[1];
+
+	int tallest = 0, bumps = 0;
+	for (int c = 0;c<width;c++)
+	{
+		tallest = std::max(tallest, heights[c]);
+		if (c > 0)
+			bumps += abs(heights[c] - heights[c - 1]);
+	}
+
+	// Blocks of the same colour, marked or not, are what squares are made of
+	int adjacent = 0;
+	static const int NEIGHBOURS[4][2] = { {1, 0}, {-1, 0}, {0, 1}, {0, -1} };
+	for (int k = 0;k<4;k++)
+	{
+		for (int n = 0;n<4;n++)
+		{
+			int colour = neighbourColour(game, placement,
+				placement.cellRow[k] + NEIGHBOURS[n][0], placement.cellCol[k] + NEIGHBOURS[n][1]);
+			if (colour == placement.cellColour[k] || colour == placement.cellColour[k] + 2)
+				adjacent++;
+		}
+	}
+
+	// How soon the bar gets to the new squares
+	int bar = (int)game.getClearBarPos();
+	double soon = 0;
+	for (int c = 0;c<width;c++)
+		if (placement.squareColumns & (1u << c))
+			soon += 1 - (double)((c - bar + width) % width) / width;
+
+	return weights.squares * placement.squares
+		+ weights.sweep * soon
+		+ weights.adjacency * adjacent
+		- weights.height * tallest
+		- weights.danger * tallest * tallest
+		- weights.bumpiness * bumps;
+}
+
+void AiPlayer::expand(int item, int worker)
+{
+	const Placement &placement = first[beam[item]];
+	double best = 0;
+	if (!placement.gameOver)
+	{
+		Game &after = games[worker];
+		after = *game;
+		after.applyPlacement(placement);
+
+		// The next piece is known, the one after isn't
+		unsigned long long hash = after.getHash();
+		if (!seen.find(hash, best))
+		{
+			Placement *next = &second[worker * MAX_PLACEMENTS];
+			int n = after.getPlacements(next);
+			best = n ? LOSING_SCORE : 0;
+			for (int i = 0;i<n;i++)
+				best = std::max(best, evaluate(after, next[i]));
+			seen.store(hash, best);
+		}
+	}
+	beamScores[item] = scores[beam[item]] + best;
+}
+
+int AiPlayer::chooseAction(const Game &newGame)
+{
+	game = &newGame;
+	int n = game->getPlacements(first);
+	if (n == 0)
+		return -1;
+
+	for (int i = 0;i<n;i++)
+	{
+		scores[i] = evaluate(*game, first[i]);
+		beam[i] = i;
+	}
+
+	// Ties go to the placement found first, which is the one needing the
+	// fewest turns, so the choice doesn't flip back and forth as the piece
+	// is steered
+	int width = std::min(beamWidth, n);
+	std::stable_sort(beam, beam + n, [this](int a, int b) { return scores[a] > scores[b]; });
+	pool.run(width, [this](int item, int worker) { expand(item, worker); });
+
+	int best = 0;
+	for (int i = 1;i<width;i++)
+		if (beamScores[i] > beamScores[best])
+			best = i;
+	const Placement &target = first[beam[best]];
+
+	if (target.rotation == 3)
+		return ACTION_ROTATE_CCW;
+	if (target.rotation != 0)
+		return ACTION_ROTATE_CW;
+	if (target.x < game->px_)
+		return ACTION_LEFT;
+	if (target.x > game->px_)
+		return ACTION_RIGHT;
+	return ACTION_DROP;
+}
+
+static double currentTime()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+int runAutoPlay(int games, int beamWidth)
+{
+	if (games < 1)
+	{
+		std::cerr << "autoplay: game count must be positive" << std::endl;
+		return 1;
+	}
+
+	AiPlayer ai(beamWidth);
+	Game game(WELL_WIDTH, WELL_HEIGHT);
+	double totalScore = 0, totalLines = 0, totalTime = 0, slowest = 0;
+	long moves = 0;
+
+	std::cout << std::fixed << std::setprecision(3);
+	for (int seed = 1;seed<=games;seed++)
+	{
+		game.reset(seed);
+		int ticks = 0;
+		bool over = false;
+		while (!over && ticks < AUTOPLAY_MAX_TICKS)
+		{
+			double start = currentTime();
+			int action = ai.chooseAction(game);
+			double taken = currentTime() - start;
+			totalTime += taken;
+			slowest = std::max(slowest, taken);
+			moves++;
+
+			if (action >= 0)
+				applyAction(&game, action);
+			over = game.tick() < 0;
+			ticks++;
+		}
+
+		// The hash tells runs that should have played out the same apart
+		std::cout << "seed " << seed << ": score " << game.getScore()
+				  << ", lines " << game.getLinesCleared() << ", " << ticks << " ticks"
+				  << (over ? "" : ", still going")
+				  << ", hash " << std::hex << game.getHash() << std::dec << std::endl;
+		totalScore += game.getScore();
+		totalLines += game.getLinesCleared();
+	}
+
+	std::cout << "autoplay: beam " << beamWidth << ", mean score " << totalScore / games
+			  << ", mean lines " << totalLines / games << std::endl;
+	std::cout << "autoplay: " << 1000 * totalTime / moves << " ms a move on average, "
+			  << 1000 * slowest << " ms at worst, against " << FASTEST_TICK << " ms a tick" << std::endl;
+	return slowest * 1000 < FASTEST_TICK ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+#ifndef AI_HPP
+#define AI_HPP
+
+#include <vector>
+
+#include "game.hpp"
+#include "threadpool.hpp"
+#include "transposition.hpp"
+
+// How much the bot cares about each thing it looks at when deciding where
+// a piece should go. Everything is counted after the piece has landed.
+struct AiWeights {
+	AiWeights();
+
+	// Per square completed
+	double squares;
+	// Per square completed, scaled from 1 just ahead of the clear bar down
+	// to nothing just behind it. The bar clears these soonest.
+	double sweep;
+	// Per cell of the piece next to a settled block of its own colour
+	double adjacency;
+	// Per row of the tallest column, and per row squared, which takes over
+	// as the stack nears the top
+	double height;
+	double danger;
+	// Per row of difference between neighbouring columns
+	double bumpiness;
+};
+
+// Plays a game one move at a time, through the same actions as
+// Viewer::on_key_press_event.
+//
+// For every move the bot scores each place the falling piece could go,
+// then takes the best beamWidth of them and scores every place the next
+// piece could go after each. Those are shared out over a pool of threads.
+// The piece is steered towards the best pair found, and dropped once it
+// is there.
+//
+// What the next piece can add is remembered by the hash of the game it
+// is placed in. The same games come up move after move while a piece is
+// steered, and whenever two placements fill the same cells the same way.
+class AiPlayer
+{
+	public:
+		// 0 threads means one per processor
+		AiPlayer(int beamWidth = 8, int threads = 0);
+
+		// The ACTION_* to make now, or -1 if there is nothing to do
+		int chooseAction(const Game &game);
+
+		const AiWeights &getWeights() const;
+		void setWeights(const AiWeights &weights);
+
+	private:
+		// Score for making a placement in the game as it is now
+		double evaluate(const Game &game, const Placement &placement) const;
+
+		// Best score the next piece can add after the given first placement
+		void expand(int item, int worker);
+
+		AiWeights weights;
+		int beamWidth;
+		ThreadPool pool;
+		TranspositionTable seen;
+
+		// The move being chosen. Placements of the falling piece, their
+		// scores, and those the beam is made of, best first.
+		const Game *game;
+		Placement first[MAX_PLACEMENTS];
+		double scores[MAX_PLACEMENTS];
+		int beam[MAX_PLACEMENTS];
+		double beamScores[MAX_PLACEMENTS];
+
+		// Scratch space for each worker in the pool: a game to make the
+		// first placement in, and room for the next piece's placements
+		std::vector<Game> games;
+		std::vector<Placement> second;
+};
+
+// Let the bot play games with seeds 1 to games as fast as it can, without
+// a window, and print how far it got and how long it took to choose its
+// moves. Returns the process exit status for lumines --autoplay, which is
+// a failure if any move took longer than a tick at the fastest speed.
+int runAutoPlay(int games, int beamWidth);
+
+#endif
@@ -0,0 +1,387 @@
+#include "animation.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Binary clips are a header, then a record per track, then every track's
+// keys back to back, all in the byte order of the machine that wrote them
+#define CLIP_MAGIC		"LANM"
+#define CLIP_VERSION	2
+#define CLIP_NAME_SIZE	32
+
+struct ClipHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t numTracks;
+	uint32_t numKeys;
+	// The text the clip was converted from, to tell when it has changed
+	uint64_t sourceHash;
+	uint32_t sourceSize;
+	uint32_t reserved;
+};
+
+struct ClipTrackRecord {
+	int32_t shapeType;
+	int32_t loop;
+	float colour[3];
+	uint32_t firstKey;
+	uint32_t numKeys;
+	char name[CLIP_NAME_SIZE];
+};
+
+KeyframeTrack::KeyframeTrack()
+	: shapeType(0), loop(false), keys(NULL), numKeys(0)
+{
+	colour[0] = colour[1] = colour[2] = 1;
+}
+
+// FNV-1a
+static uint64_t hashText(const std::string &text)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0;i<text.size();i++)
+		hash = (hash ^ (unsigned char)text[i]) * 1099511628211ULL;
+	return hash;
+}
+
+static bool readText(const char *filename, std::string &text)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file.is_open())
+		return false;
+	std::ostringstream contents;
+	contents << file.rdbuf();
+	text = contents.str();
+	return true;
+}
+
+int KeyframeTrack::length() const
+{
+	return numKeys ? keys[numKeys - 1].time + 1 : 0;
+}
+
+static bool keyReachedBefore(int time, const KeyFrame &key)
+{
+	return time < key.time;
+}
+
+void KeyframeTrack::sample(float time, Point3D &position, float scale[3], float rotate[3]) const
+{
+	if (!numKeys)
+		return;
+
+	if (loop)
+	{
+		time = fmod(time, (float)length());
+		if (time < 0)
+			time += length();
+	}
+
+	// First key reached after time, and how far along we are towards it
+	int k = std::upper_bound(keys, keys + numKeys, (int)floor(time), keyReachedBefore) - keys;
+	if (k == 0)
+		k = 1;
+	if (k >= numKeys)
+	{
+		const KeyFrame &last = keys[numKeys - 1];
+		position = Point3D(last.position[0], last.position[1], last.position[2]);
+		for (int i = 0;i<3;i++)
+		{
+			scale[i] = last.scale[i];
+			rotate[i] = last.rotate[i];
+		}
+		return;
+	}
+
+	const KeyFrame &from = keys[k - 1];
+	const KeyFrame &to = keys[k];
+	float t = 1;
+	if (to.frames > 0)
+		t = std::min(std::max((time - from.time - 1) / to.frames, 0.f), 1.f);
+
+	float p[3];
+	for (int i = 0;i<3;i++)
+	{
+		p[i] = from.position[i] + t * (to.position[i] - from.position[i]);
+		scale[i] = from.scale[i] + t * (to.scale[i] - from.scale[i]);
+		rotate[i] = from.rotate[i] + t * (to.rotate[i] - from.rotate[i]);
+	}
+	position = Point3D(p[0], p[1], p[2]);
+}
+
+AnimationClip::AnimationClip()
+	: sourceHash(0), sourceSize(0), mapping(NULL), mappingSize(0)
+{
+}
+
+AnimationClip::~AnimationClip()
+{
+	unload();
+}
+
+void AnimationClip::unload()
+{
+	tracks.clear();
+	keyStorage.clear();
+	if (mapping)
+		munmap(mapping, mappingSize);
+	mapping = NULL;
+	mappingSize = 0;
+}
+
+bool AnimationClip::load(const char *filename)
+{
+	unload();
+
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+	{
+		std::cerr << "Could not open animation " << filename << std::endl;
+		return false;
+	}
+
+	struct stat st;
+	ClipHeader header;
+	bool binary = fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(header)
+		&& read(fd, &header, sizeof(header)) == sizeof(header)
+		&& memcmp(header.magic, CLIP_MAGIC, 4) == 0;
+
+	bool ok = binary ? loadBinary(filename, fd, st.st_size) : loadText(filename);
+	close(fd);
+	return ok;
+}
+
+bool AnimationClip::loadBinary(const char *filename, int fd, size_t size)
+{
+	mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (mapping == MAP_FAILED)
+	{
+		mapping = NULL;
+		std::cerr << "Could not map animation " << filename << std::endl;
+		return false;
+	}
+	mappingSize = size;
+
+	// Everything is used in place. All we check is that the counts and
+	// key ranges stay inside the file.
+	const ClipHeader *header = (const ClipHeader *)mapping;
+	const ClipTrackRecord *records = (const ClipTrackRecord *)(header + 1);
+	const KeyFrame *keys = (const KeyFrame *)(records + header->numTracks);
+	if (header->version != CLIP_VERSION
+		|| header->numTracks > size / sizeof(ClipTrackRecord)
+		|| header->numKeys > size / sizeof(KeyFrame)
+		|| sizeof(ClipHeader) + header->numTracks * sizeof(ClipTrackRecord) + header->numKeys * sizeof(KeyFrame) != size)
+	{
+		std::cerr << filename << ": not a version " << CLIP_VERSION << " animation clip" << std::endl;
+		unload();
+		return false;
+	}
+
+	tracks.resize(header->numTracks);
+	for (unsigned int i = 0;i<header->numTracks;i++)
+	{
+		const ClipTrackRecord &record = records[i];
+		if (record.firstKey > header->numKeys || record.numKeys > header->numKeys - record.firstKey)
+		{
+			std::cerr << filename << ": track " << i << " has keys outside the file" << std::endl;
+			unload();
+			return false;
+		}
+
+		KeyframeTrack &track = tracks[i];
+		track.shapeType = record.shapeType;
+		track.loop = record.loop != 0;
+		for (int c = 0;c<3;c++)
+			track.colour[c] = record.colour[c];
+		track.name.assign(record.name, strnlen(record.name, CLIP_NAME_SIZE));
+		track.keys = keys + record.firstKey;
+		track.numKeys = record.numKeys;
+	}
+	sourceHash = header->sourceHash;
+	sourceSize = header->sourceSize;
+	return true;
+}
+
+bool AnimationClip::loadText(const char *filename)
+{
+	std::string text;
+	if (!readText(filename, text))
+	{
+		std::cerr << "Could not open animation " << filename << std::endl;
+		return false;
+	}
+	sourceHash = hashText(text);
+	sourceSize = text.size();
+	std::istringstream file(text);
+
+	// Keys go into one array. The tracks are pointed at it once it has
+	// stopped growing.
+	std::vector<int> firstKeys;
+	int numKeyFrames, loop;
+	KeyframeTrack track;
+	while (file >> track.shapeType >> numKeyFrames >> loop >> track.colour[0] >> track.colour[1] >> track.colour[2])
+	{
+		file >> std::ws;
+		getline(file, track.name);
+		track.loop = loop != 0;
+		track.numKeys = numKeyFrames;
+		if (numKeyFrames < 1)
+		{
+			std::cerr << filename << ": " << track.name << " has no keyframes" << std::endl;
+			unload();
+			return false;
+		}
+
+		tracks.push_back(track);
+		firstKeys.push_back(keyStorage.size());
+		for (int i = 0;i<numKeyFrames;i++)
+		{
+			KeyFrame key;
+			file >> key.position[0] >> key.position[1] >> key.position[2];
+			file >> key.scale[0] >> key.scale[1] >> key.scale[2];
+			file >> key.rotate[0] >> key.rotate[1] >> key.rotate[2];
+			file >> key.frames;
+			if (!file)
+			{
+				std::cerr << filename << ": bad keyframe in " << track.name << std::endl;
+				unload();
+				return false;
+			}
+
+			// A key is reached one frame after the previous one plus however
+			// many frames it takes to move there
+			key.frames = std::max(key.frames, 0);
+			key.time = i == 0 ? 0 : keyStorage.back().time + 1 + key.frames;
+			keyStorage.push_back(key);
+		}
+	}
+
+	for (unsigned int i = 0;i<tracks.size();i++)
+		tracks[i].keys = &keyStorage[firstKeys[i]];
+	return true;
+}
+
+bool AnimationClip::save(const char *filename) const
+{
+	FILE *file = fopen(filename, "wb");
+	if (!file)
+		return false;
+
+	ClipHeader header;
+	memcpy(header.magic, CLIP_MAGIC, 4);
+	header.version = CLIP_VERSION;
+	header.numTracks = tracks.size();
+	header.numKeys = 0;
+	header.sourceHash = sourceHash;
+	header.sourceSize = sourceSize;
+	header.reserved = 0;
+	for (unsigned int i = 0;i<tracks.size();i++)
+		header.numKeys += tracks[i].numKeys;
+	fwrite(&header, sizeof(header), 1, file);
+
+	uint32_t firstKey = 0;
+	for (unsigned int i = 0;i<tracks.size();i++)
+	{
+		ClipTrackRecord record;
+		memset(&record, 0, sizeof(record));
+		record.shapeType = tracks[i].shapeType;
+		record.loop = tracks[i].loop;
+		for (int c = 0;c<3;c++)
+			record.colour[c] = tracks[i].colour[c];
+		record.firstKey = firstKey;
+		record.numKeys = tracks[i].numKeys;
+		memcpy(record.name, tracks[i].name.c_str(), std::min<size_t>(tracks[i].name.size(), CLIP_NAME_SIZE - 1));
+		fwrite(&record, sizeof(record), 1, file);
+		firstKey += tracks[i].numKeys;
+	}
+
+	for (unsigned int i = 0;i<tracks.size();i++)
+		fwrite(tracks[i].keys, sizeof(KeyFrame), tracks[i].numKeys, file);
+
+	bool ok = !ferror(file);
+	fclose(file);
+	return ok;
+}
+
+bool AnimationClip::isConvertedFrom(const char *filename) const
+{
+	std::string text;
+	return readText(filename, text) && text.size() == sourceSize && hashText(text) == sourceHash;
+}
+
+bool AnimationClip::finished(float time) const
+{
+	for (unsigned int i = 0;i<tracks.size();i++)
+		if (!tracks[i].loop && time >= tracks[i].length())
+			return true;
+	return false;
+}
+
+bool AnimationClip::isAnimated() const
+{
+	for (unsigned int i = 0;i<tracks.size();i++)
+	{
+		const KeyframeTrack &track = tracks[i];
+		for (int k = 1;k<track.numKeys;k++)
+			for (int c = 0;c<3;c++)
+				if (track.keys[k].position[c] != track.keys[0].position[c]
+					|| track.keys[k].scale[c] != track.keys[0].scale[c]
+					|| track.keys[k].rotate[c] != track.keys[0].rotate[c])
+					return true;
+	}
+	return false;
+}
+
+AnimationCache::~AnimationCache()
+{
+	for (unsigned int i = 0;i<clips.size();i++)
+		delete clips[i];
+}
+
+int AnimationCache::load(const char *name)
+{
+	std::map<std::string, int>::iterator it = handles.find(name);
+	if (it != handles.end())
+		return it->second;
+
+	AnimationClip *clip = new AnimationClip;
+	// The binary clip, unless the text has been edited since it was
+	// converted
+	std::string binary = std::string(name) + ".anim";
+	std::string text = std::string(name) + ".txt";
+	if (access(binary.c_str(), R_OK) != 0 || !clip->load(binary.c_str())
+		|| (access(text.c_str(), R_OK) == 0 && !clip->isConvertedFrom(text.c_str())))
+		clip->load(text.c_str());
+
+	int handle = clips.size();
+	clips.push_back(clip);
+	handles[name] = handle;
+	return handle;
+}
+
+const AnimationClip &AnimationCache::get(int handle) const
+{
+	return *clips[handle];
+}
+
+int convertAnimation(const char *in, const char *out)
+{
+	AnimationClip clip;
+	if (!clip.load(in))
+		return 1;
+	if (!clip.save(out))
+	{
+		std::cerr << "Could not write animation " << out << std::endl;
+		return 1;
+	}
+	std::cout << in << ": " << clip.tracks.size() << " tracks written to " << out << std::endl;
+	return 0;
+}
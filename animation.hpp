@@ -0,0 +1,118 @@
+#ifndef ANIMATION_HPP
+#define ANIMATION_HPP
+
+#include "algebra.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// One pose of an animated part. This is also exactly how keys are laid out
+// in a binary clip, so mapped clips are used in place.
+struct KeyFrame {
+	float position[3];
+	float scale[3];
+	// Degrees about the x, y and z axes
+	float rotate[3];
+	// Frames spent moving here from the previous key, ignored on the first
+	int32_t frames;
+	// Frame at which the key is reached, counted from the start of the track
+	int32_t time;
+};
+
+// A shape moving through a list of keyframes. Only the keys are stored,
+// the poses in between are interpolated when the track is sampled. The
+// keys belong to the clip the track came from.
+class KeyframeTrack
+{
+	public:
+		KeyframeTrack();
+
+		// Number of frames the track lasts
+		int length() const;
+
+		// Pose at the given time, in frames since the track started. Looping
+		// tracks wrap around, others hold their last key.
+		void sample(float time, Point3D &position, float scale[3], float rotate[3]) const;
+
+		// 0 = square, 1 = sphere
+		int shapeType;
+		bool loop;
+		float colour[3];
+		std::string name;
+
+		const KeyFrame *keys;
+		int numKeys;
+};
+
+// All the parts of the mascot for one mood, played together.
+//
+// Clips come either from the text format: for every part a line of "shape
+// keys loop r g b NAME" followed by one line per key of "x y z sx sy sz rx
+// ry rz frames"; or from the binary format written by save, which is mapped
+// straight into memory. See convertAnimation.
+class AnimationClip
+{
+	public:
+		AnimationClip();
+		~AnimationClip();
+
+		// Either format, told apart by the binary header
+		bool load(const char *filename);
+		bool save(const char *filename) const;
+
+		// True if the file holds exactly the text the clip was read or
+		// converted from
+		bool isConvertedFrom(const char *filename) const;
+
+		// True once any track that doesn't loop has played out
+		bool finished(float time) const;
+		
+		// False if every part holds still, so there is nothing to redraw
+		bool isAnimated() const;
+
+		std::vector<KeyframeTrack> tracks;
+
+	private:
+		// Clips point into their own storage, so they can't be copied
+		AnimationClip(const AnimationClip &);
+		AnimationClip &operator =(const AnimationClip &);
+
+		void unload();
+		bool loadText(const char *filename);
+		bool loadBinary(const char *filename, int fd, size_t size);
+
+		// Size and hash of the text the clip came from
+		uint64_t sourceHash;
+		uint32_t sourceSize;
+
+		// Keys of a text clip, or the mapped binary file
+		std::vector<KeyFrame> keyStorage;
+		void *mapping;
+		size_t mappingSize;
+};
+
+// Every clip the game has loaded, each read only the first time it is
+// asked for. Clips are referred to by the handle load returns.
+class AnimationCache
+{
+	public:
+		~AnimationCache();
+
+		// Loads name.anim, or name.txt if there is no binary clip or the
+		// text is not what it was converted from. A clip that can't be read
+		// still gets a handle, to an empty clip.
+		int load(const char *name);
+		const AnimationClip &get(int handle) const;
+
+	private:
+		std::vector<AnimationClip *> clips;
+		std::map<std::string, int> handles;
+};
+
+// Write the text clip in as the binary clip out. Returns the process exit
+// status for lumines --convert-animation.
+int convertAnimation(const char *in, const char *out);
+
+#endif
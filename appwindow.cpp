@@ -13,7 +13,7 @@ AppWindow::AppWindow()
 	using Gtk::Menu_Helpers::CheckMenuElem;
 
 	// Slots to connect to functions
-	sigc::slot1<void, Viewer::DrawMode> draw_slot = sigc::mem_fun(m_viewer, &Viewer::setDrawMode);
+	sigc::slot1<void, Renderer::DrawMode> draw_slot = sigc::mem_fun(m_viewer, &Viewer::setDrawMode);
 	sigc::slot0<void> sound_slot = sigc::mem_fun(m_viewer, &Viewer::toggleSound);
 
 	// Set up the application menu
@@ -33,6 +33,7 @@ AppWindow::AppWindow()
 	m_menu_drawMode.items().push_back(MenuElem("_Draw Shadow", Gtk::AccelKey("d"), sigc::mem_fun(m_viewer, &Viewer::toggleShadows ) ) );
 
 	m_menu_drawMode.items().push_back(CheckMenuElem("_Enable Sound", Gtk::AccelKey("s"), sound_slot ));
+	m_menu_drawMode.items().push_back(MenuElem("Show Pro_file", Gtk::AccelKey("f"), sigc::mem_fun(m_viewer, &Viewer::toggleProfile ) ) );
 	
 	// Set up the menu bar
 	m_menubar.items().push_back(Gtk::Menu_Helpers::MenuElem("_File", m_menu_app));
@@ -96,3 +97,8 @@ void AppWindow::updateScore(int newScore)
 }
 
 
+
+void AppWindow::setRecordFile(const std::string &filename)
+{
+	m_viewer.setRecordFile(filename);
+}
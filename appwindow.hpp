@@ -9,6 +9,7 @@ public:
   AppWindow();
 	void updateScore(int newScore);
 	void updateLinesCleared(int linesCleared);
+	void setRecordFile(const std::string &filename);
   
 protected:
 	virtual bool on_key_press_event( GdkEventKey *ev );
@@ -0,0 +1,139 @@
+#include "benchmark.hpp"
+#include "renderer.hpp"
+#include "replay.hpp"
+#include "offscreen.hpp"
+#include <sys/time.h>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+static double currentTime()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void printOptions(int options)
+{
+	std::cout << ((options & Renderer::TEXTURES) ? "tex " : "    ")
+			  << ((options & Renderer::BUMP_MAPPING) ? "bump " : "     ")
+			  << ((options & Renderer::TRANSLUCENCY) ? "trans " : "      ")
+			  << ((options & Renderer::SHADOWS) ? "shadow " : "       ")
+			  << ((options & Renderer::MOTION_BLUR) ? "blur " : "     ");
+}
+
+// Tick the game once and show the renderer how it turned out. Returns
+// whether the game is over.
+static bool tick(GameEngine &engine, Renderer &renderer)
+{
+	engine.step();
+	const GameSnapshot &snapshot = engine.latest();
+	renderer.setSnapshot(&snapshot);
+	GameEvent event;
+	while (engine.pollEvent(event))
+		renderer.gameEvent(event);
+	return snapshot.gameOver;
+}
+
+// Milliseconds at fraction p of the way through the sorted times
+static double percentile(const std::vector<double> &sorted, double p)
+{
+	unsigned int i = (unsigned int)(p * (sorted.size() - 1) + 0.5);
+	return 1000.0 * sorted[i];
+}
+
+int runBenchmark(int frames, const char *replayFile, int width, int height)
+{
+	if (frames < 1)
+	{
+		std::cerr << "benchmark: frame count must be positive" << std::endl;
+		return 1;
+	}
+	
+	Replay replay;
+	if (replayFile)
+	{
+		if (!replay.load(replayFile))
+		{
+			std::cerr << "benchmark: could not read replay " << replayFile << std::endl;
+			return 1;
+		}
+	}
+	else
+		replay.generate(frames);
+	
+	OffscreenContext offscreen;
+	if (!offscreen.create(width, height))
+		return 1;
+	
+	// Motion blur can only be measured if the context happens to provide
+	// an accumulation buffer
+	bool accum = offscreen.hasAccumBuffer();
+	
+	std::cout << "benchmark: " << glGetString(GL_RENDERER) << ", "
+			  << width << "x" << height << ", " << frames << " frames per combination" << std::endl;
+	if (!accum)
+		std::cout << "benchmark: no accumulation buffer, skipping motion blur" << std::endl;
+	
+	int status = 0;
+	{
+		GameEngine engine;
+		Renderer renderer;
+		renderer.initGL();
+		renderer.resizeGL(width, height);
+		renderer.startScreen = false;
+		
+		std::vector<double> times(frames);
+		for (int options = 0;options<32;options++)
+		{
+			if ((options & Renderer::MOTION_BLUR) && !accum)
+				continue;
+				
+			renderer.setRenderOptions(options);
+			engine.postReset(replay.seed);
+			unsigned int nextEvent = 0;
+			int ticks = 0;
+			bool gameOver = false;
+			
+			for (int frame = 0;frame<frames;frame++)
+			{
+				// One game tick per frame, applying whatever moves were made
+				// before it. A finished game starts over from the same seed.
+				if (gameOver)
+				{
+					engine.postReset(replay.seed);
+					nextEvent = 0;
+					ticks = 0;
+				}
+				while (nextEvent < replay.events.size() && replay.events[nextEvent].tick <= ticks)
+					engine.postAction(replay.events[nextEvent++].action);
+				gameOver = tick(engine, renderer);
+				ticks++;
+				
+				double start = currentTime();
+				renderer.renderFrame();
+				glFinish();
+				times[frame] = currentTime() - start;
+			}
+			
+			std::sort(times.begin(), times.end());
+			printOptions(options);
+			std::cout << std::fixed << std::setprecision(2)
+					  << " p50 " << percentile(times, 0.5)
+					  << " p90 " << percentile(times, 0.9)
+					  << " p99 " << percentile(times, 0.99)
+					  << " max " << 1000.0 * times.back() << " ms" << std::endl;
+		}
+		
+		GLenum error = glGetError();
+		if (error != GL_NO_ERROR)
+		{
+			std::cerr << "benchmark: GL error 0x" << std::hex << error << std::endl;
+			status = 1;
+		}
+	}
+	
+	return status;
+}
@@ -0,0 +1,14 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+// Render frames of a replayed game offscreen, once for every combination of
+// textures, bump mapping, translucency, shadows and motion blur, and print
+// frame time percentiles for each. Needs no window or display server.
+//
+// If replayFile is NULL a fixed pseudo random sequence of moves is played
+// instead, so runs on different machines are still comparable.
+//
+// Returns the process exit status.
+int runBenchmark(int frames, const char *replayFile, int width = 800, int height = 600);
+
+#endif
@@ -0,0 +1,254 @@
+#include "engine.hpp"
+#include <chrono>
+#include <iostream>
+
+#define SNAPSHOT_FRESH 4
+
+GameEngine::GameEngine()
+	: game(WELL_WIDTH, WELL_HEIGHT)
+	, ticks(0)
+	, gameOver(false)
+	, back(0)
+	, front(1)
+	, middle(2)
+	, interval(500)
+	, paused(false)
+	, running(false)
+	, autoPlayer(NULL)
+	, inputPending(false)
+{
+	// So there is something to draw before the first tick
+	publish();
+	latest();
+}
+
+GameEngine::~GameEngine()
+{
+	stop();
+}
+
+void GameEngine::start(int newInterval, const std::function<void()> &newPublished)
+{
+	interval = newInterval;
+	published = newPublished;
+	running = true;
+	thread = std::thread(&GameEngine::run, this);
+}
+
+void GameEngine::stop()
+{
+	if (thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(wakeMutex);
+			running = false;
+		}
+		wake.notify_one();
+		thread.join();
+	}
+
+	// Anything posted after the last loop, such as a final replay save
+	applyInput();
+}
+
+void GameEngine::setInterval(int newInterval)
+{
+	interval = newInterval;
+}
+
+void GameEngine::setPaused(bool newPaused)
+{
+	paused = newPaused;
+}
+
+bool GameEngine::isPaused() const
+{
+	return paused;
+}
+
+void GameEngine::post(int type, unsigned int value)
+{
+	Command command;
+	command.type = type;
+	command.value = value;
+	if (!commands.push(command))
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		inputPending = true;
+	}
+	wake.notify_one();
+}
+
+void GameEngine::postAction(int action)
+{
+	post(COMMAND_ACTION, action);
+}
+
+void GameEngine::postReset(unsigned int seed)
+{
+	post(COMMAND_RESET, seed);
+}
+
+void GameEngine::setRecordFile(const std::string &filename)
+{
+	std::lock_guard<std::mutex> lock(wakeMutex);
+	recordFile = filename;
+}
+
+void GameEngine::saveReplay()
+{
+	post(COMMAND_SAVE_REPLAY, 0);
+}
+
+void GameEngine::setAutoPlayer(AiPlayer *ai)
+{
+	autoPlayer = ai;
+}
+
+bool GameEngine::act(int action)
+{
+	replay.record(ticks, action);
+	return applyAction(&game, action);
+}
+
+bool GameEngine::applyInput()
+{
+	bool changed = false;
+	Command command;
+	while (commands.pop(command))
+	{
+		switch (command.type)
+		{
+			case COMMAND_ACTION:
+				// A move that can't be made changes nothing to show
+				if (act(command.value))
+					changed = true;
+				break;
+			case COMMAND_RESET:
+				game.reset(command.value);
+				replay.clear(command.value);
+				ticks = 0;
+				gameOver = false;
+				changed = true;
+				break;
+			case COMMAND_SAVE_REPLAY:
+			{
+				std::string filename;
+				{
+					std::lock_guard<std::mutex> lock(wakeMutex);
+					filename = recordFile;
+				}
+				if (!filename.empty() && !replay.events.empty() && !replay.save(filename.c_str()))
+					std::cerr << "Could not write replay to " << filename << std::endl;
+				break;
+			}
+		}
+	}
+	return changed;
+}
+
+void GameEngine::tick()
+{
+	AiPlayer *ai = autoPlayer;
+	if (ai && !gameOver)
+	{
+		int action = ai->chooseAction(game);
+		if (action >= 0)
+			act(action);
+	}
+
+	if (game.tick() < 0)
+		gameOver = true;
+	ticks++;
+}
+
+void GameEngine::step()
+{
+	applyInput();
+	tick();
+	publish();
+}
+
+void GameEngine::publish()
+{
+	// Pass on the game's events first. If nobody is reading them the
+	// newest are the ones dropped.
+	GameEvent event;
+	while (game.pollEvent(event))
+		events.push(event);
+
+	GameSnapshot &snapshot = snapshots[back];
+	for (int r = 0;r<WELL_HEIGHT+4;r++)
+	{
+		for (int c = 0;c<WELL_WIDTH;c++)
+		{
+			snapshot.cells[r][c] = game.get(r, c);
+			snapshot.pieceCells[r][c] = game.getPieceCell(r, c);
+		}
+	}
+	snapshot.px = game.px_;
+	snapshot.py = game.py_;
+	snapshot.ghostRow[0] = game.getGhostRow(0);
+	snapshot.ghostRow[1] = game.getGhostRow(1);
+	snapshot.fallFraction = game.getFallFraction();
+	snapshot.clearBarPos = game.getClearBarPos();
+	game.getNextPieceColour(snapshot.nextPieceColour);
+	snapshot.score = game.getScore();
+	snapshot.linesCleared = game.getLinesCleared();
+	snapshot.counter = game.counter;
+	snapshot.ticks = ticks;
+	snapshot.gameOver = gameOver;
+	snapshot.hash = game.getHash();
+
+	back = middle.exchange(back | SNAPSHOT_FRESH) & ~SNAPSHOT_FRESH;
+}
+
+const GameSnapshot &GameEngine::latest()
+{
+	if (middle.load() & SNAPSHOT_FRESH)
+		front = middle.exchange(front) & ~SNAPSHOT_FRESH;
+	return snapshots[front];
+}
+
+bool GameEngine::pollEvent(GameEvent &event)
+{
+	return events.pop(event);
+}
+
+void GameEngine::run()
+{
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point nextTick = Clock::now() + std::chrono::milliseconds(interval);
+	while (running)
+	{
+		bool changed = applyInput();
+
+		Clock::time_point now = Clock::now();
+		std::chrono::milliseconds period(interval);
+		if (paused)
+			nextTick = now + period;
+		else if (now >= nextTick)
+		{
+			tick();
+			changed = true;
+
+			// After a stall, carry on from now rather than catching up
+			nextTick += period;
+			if (nextTick <= now)
+				nextTick = now + period;
+		}
+
+		if (changed)
+		{
+			publish();
+			if (published)
+				published();
+		}
+
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		wake.wait_until(lock, nextTick, [this] { return inputPending || !running; });
+		inputPending = false;
+	}
+}
@@ -0,0 +1,175 @@
+#ifndef ENGINE_HPP
+#define ENGINE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "ai.hpp"
+#include "game.hpp"
+#include "replay.hpp"
+
+// A queue between exactly one thread pushing and one thread popping, with
+// no locks. N must be a power of two.
+template <typename T, unsigned int N>
+class SpscQueue
+{
+	public:
+		SpscQueue() : head(0), tail(0) {}
+
+		// False if the queue is full
+		bool push(const T &item)
+		{
+			unsigned int t = tail.load(std::memory_order_relaxed);
+			if (t - head.load(std::memory_order_acquire) == N)
+				return false;
+			items[t & (N - 1)] = item;
+			tail.store(t + 1, std::memory_order_release);
+			return true;
+		}
+
+		// False if the queue is empty
+		bool pop(T &item)
+		{
+			unsigned int h = head.load(std::memory_order_relaxed);
+			if (h == tail.load(std::memory_order_acquire))
+				return false;
+			item = items[h & (N - 1)];
+			head.store(h + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		T items[N];
+		std::atomic<unsigned int> head, tail;
+};
+
+// Everything the renderer reads from the game at one moment, with the
+// same meaning as the Game accessors of the same name
+struct GameSnapshot {
+	int get(int r, int c) const
+	{
+		return cells[r][c];
+	}
+	int getPieceCell(int r, int c) const
+	{
+		return pieceCells[r][c];
+	}
+
+	int cells[WELL_HEIGHT+4][WELL_WIDTH];
+	int pieceCells[WELL_HEIGHT+4][WELL_WIDTH];
+	int px, py;
+	int ghostRow[2];
+	double fallFraction;
+	double clearBarPos;
+	int nextPieceColour[4];
+	int score, linesCleared;
+	int counter;
+
+	// Ticks since the game was last reset
+	int ticks;
+	bool gameOver;
+
+	// Game::getHash, to check that two runs stay in step
+	unsigned long long hash;
+};
+
+// Owns a Game and runs it, on a thread of its own once started. Input is
+// queued to the engine; the engine publishes snapshots of the game and
+// the events it raised. Nothing else touches the game, so a slow frame
+// never holds up a tick and a slow tick never holds up a frame.
+//
+// Snapshots are triple buffered: the engine fills one while the newest
+// complete one waits in the middle and the reader holds on to the third.
+class GameEngine
+{
+	public:
+		GameEngine();
+		~GameEngine();
+
+		// Tick every interval milliseconds on a new thread, calling
+		// published from that thread after every new snapshot. Engines
+		// that aren't started are stepped by hand instead.
+		void start(int interval, const std::function<void()> &published);
+		void stop();
+
+		void setInterval(int interval);
+		void setPaused(bool paused);
+		bool isPaused() const;
+
+		// Input for the game, applied in the order it was posted before
+		// the next tick. Moves are recorded in a replay that starts over
+		// on every reset; saveReplay writes it to the record file, if one
+		// has been set.
+		void postAction(int action);
+		void postReset(unsigned int seed);
+		void setRecordFile(const std::string &filename);
+		void saveReplay();
+
+		// Hand the game over to a bot, which makes one move before every
+		// tick and is recorded like a player. NULL takes it back. The bot
+		// is only used by the engine from then on.
+		void setAutoPlayer(AiPlayer *ai);
+
+		// Apply the input posted so far, tick once and publish. Only for
+		// engines that weren't started.
+		void step();
+
+		// The newest snapshot. It stays as it is until the next call, which
+		// must come from the same thread.
+		const GameSnapshot &latest();
+
+		// Events the game raised, oldest first
+		bool pollEvent(GameEvent &event);
+
+	private:
+		enum CommandType {
+			COMMAND_ACTION,
+			COMMAND_RESET,
+			COMMAND_SAVE_REPLAY
+		};
+		struct Command {
+			int type;
+			unsigned int value;
+		};
+
+		void post(int type, unsigned int value);
+		bool act(int action);
+		bool applyInput();
+		void tick();
+		void publish();
+		void run();
+
+		// Only ever touched by the engine thread, or by whoever steps it
+		Game game;
+		int ticks;
+		bool gameOver;
+		Replay replay;
+
+		SpscQueue<Command, 256> commands;
+		SpscQueue<GameEvent, EVENT_QUEUE_SIZE> events;
+
+		// Slot indices. The middle one carries SNAPSHOT_FRESH until the
+		// reader has taken it.
+		GameSnapshot snapshots[3];
+		unsigned int back, front;
+		std::atomic<unsigned int> middle;
+
+		std::atomic<int> interval;
+		std::atomic<bool> paused, running;
+		std::atomic<AiPlayer *> autoPlayer;
+		std::thread thread;
+		std::function<void()> published;
+
+		// Wakes the engine thread early when there is input. Also guards
+		// the record file name.
+		std::mutex wakeMutex;
+		std::condition_variable wake;
+		bool inputPending;
+		std::string recordFile;
+};
+
+#endif
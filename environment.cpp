@@ -0,0 +1,193 @@
+#include "environment.hpp"
+#include "replay.hpp"
+#include <sys/time.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+BatchEnvironment::BatchEnvironment(int numGames, int newTicksPerStep, int threads)
+	: ticksPerStep(std::max(newTicksPerStep, 1))
+	, pool(threads)
+	, games(std::max(numGames, 0))
+	, boardData(games.size() * ENV_BOARD_SIZE)
+	, pieceData(games.size() * ENV_PIECE_SIZE)
+	, nextPieceData(games.size() * ENV_NEXT_PIECE_SIZE)
+	, clearBarData(games.size())
+	, rewardData(games.size())
+	, doneData(games.size())
+{
+	for (int i = 0;i<size();i++)
+		reset(i, i);
+}
+
+int BatchEnvironment::size() const
+{
+	return games.size();
+}
+
+void BatchEnvironment::reset(const unsigned int *seeds)
+{
+	for (int i = 0;i<size();i++)
+		reset(i, seeds[i]);
+}
+
+void BatchEnvironment::reset(int game, unsigned int seed)
+{
+	games[game].reset(seed);
+	rewardData[game] = 0;
+	doneData[game] = 0;
+	observe(game);
+}
+
+void BatchEnvironment::step(const int *actions)
+{
+	// One run of neighbouring games per thread, rather than a job per game.
+	// The job is kept small enough for std::function not to allocate.
+	pool.run(std::min(pool.size(), size()), [this, actions](int item, int)
+	{
+		int batches = std::min(pool.size(), size());
+		stepGames(size() * item / batches, size() * (item + 1) / batches, actions);
+	});
+}
+
+void BatchEnvironment::stepGames(int first, int last, const int *actions)
+{
+	for (int i = first;i<last;i++)
+	{
+		if (doneData[i])
+		{
+			rewardData[i] = 0;
+			continue;
+		}
+
+		Game &game = games[i];
+		int score = game.getScore();
+		if (actions[i] >= 0 && actions[i] < NUM_ACTIONS)
+			applyAction(&game, actions[i]);
+		for (int t = 0;t<ticksPerStep && !doneData[i];t++)
+			doneData[i] = game.tick() < 0;
+
+		// Nobody reads the events
+		GameEvent event;
+		while (game.pollEvent(event))
+			;
+
+		rewardData[i] = game.getScore() - score;
+		observe(i);
+	}
+}
+
+void BatchEnvironment::observe(int i)
+{
+	Game &game = games[i];
+
+	unsigned char *board = &boardData[i * ENV_BOARD_SIZE];
+	memset(board, 0, ENV_BOARD_SIZE);
+	for (int r = 0;r<ENV_ROWS;r++)
+	{
+		for (int c = 0;c<ENV_COLUMNS;c++)
+		{
+			int colour = game.get(r, c);
+			if (colour > 0)
+				board[((colour - 1) * ENV_ROWS + r) * ENV_COLUMNS + c] = 1;
+		}
+	}
+
+	int *piece = &pieceData[i * ENV_PIECE_SIZE];
+	piece[0] = game.getPieceCell(game.py_ - 1, game.px_ + 1);
+	piece[1] = game.getPieceCell(game.py_ - 1, game.px_ + 2);
+	piece[2] = game.getPieceCell(game.py_ - 2, game.px_ + 1);
+	piece[3] = game.getPieceCell(game.py_ - 2, game.px_ + 2);
+	piece[4] = game.px_;
+	piece[5] = game.py_;
+
+	game.getNextPieceColour(&nextPieceData[i * ENV_NEXT_PIECE_SIZE]);
+	clearBarData[i] = game.getClearBarPos();
+}
+
+const unsigned char *BatchEnvironment::boards() const
+{
+	return boardData.data();
+}
+
+const int *BatchEnvironment::pieces() const
+{
+	return pieceData.data();
+}
+
+const int *BatchEnvironment::nextPieces() const
+{
+	return nextPieceData.data();
+}
+
+const float *BatchEnvironment::clearBarPositions() const
+{
+	return clearBarData.data();
+}
+
+const float *BatchEnvironment::rewards() const
+{
+	return rewardData.data();
+}
+
+const unsigned char *BatchEnvironment::done() const
+{
+	return doneData.data();
+}
+
+static double currentTime()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+int runEnvironmentBenchmark(int games, int steps)
+{
+	if (games < 1 || steps < 1)
+	{
+		std::cerr << "env-benchmark: game and step counts must be positive" << std::endl;
+		return 1;
+	}
+
+	BatchEnvironment env(games);
+	std::vector<int> actions(games);
+	std::vector<unsigned int> seeds(games);
+	for (int i = 0;i<games;i++)
+		seeds[i] = i + 1;
+	env.reset(seeds.data());
+
+	// Moves from a generator of our own, the same on every machine. Games
+	// that end start over from a new seed, as they would in training.
+	unsigned int state = 12345;
+	unsigned int nextSeed = games + 1;
+	double totalReward = 0;
+	int finished = 0;
+	double start = currentTime();
+	for (int s = 0;s<steps;s++)
+	{
+		for (int i = 0;i<games;i++)
+		{
+			state = state * 1103515245 + 12345;
+			int r = (state >> 16) & 0x7fff;
+			actions[i] = r % 3 == 0 ? (r / 3) % NUM_ACTIONS : -1;
+		}
+		env.step(actions.data());
+
+		for (int i = 0;i<games;i++)
+		{
+			totalReward += env.rewards()[i];
+			if (env.done()[i])
+			{
+				env.reset(i, nextSeed++);
+				finished++;
+			}
+		}
+	}
+	double taken = currentTime() - start;
+
+	std::cout << "env-benchmark: " << games << " games, " << steps << " steps, "
+			  << (long)((double)games * steps / taken) << " game steps a second, "
+			  << finished << " games finished, " << totalReward << " total reward" << std::endl;
+	return 0;
+}
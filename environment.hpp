@@ -0,0 +1,79 @@
+#ifndef ENVIRONMENT_HPP
+#define ENVIRONMENT_HPP
+
+#include <vector>
+
+#include "game.hpp"
+#include "threadpool.hpp"
+
+// Layout of one game's observation. The board is one plane of 0s and 1s
+// per colour: x, o, marked x and marked o. Each plane is rows by columns
+// with row 0 at the bottom. The falling piece isn't on the board.
+#define ENV_PLANES		4
+#define ENV_ROWS		(WELL_HEIGHT + 4)
+#define ENV_COLUMNS		WELL_WIDTH
+#define ENV_BOARD_SIZE	(ENV_PLANES * ENV_ROWS * ENV_COLUMNS)
+
+// The falling piece is the colours of its 2x2 block row by row from the
+// top left, then its column and row as Game's px_ and py_. The next piece
+// is just its colours.
+#define ENV_PIECE_SIZE		6
+#define ENV_NEXT_PIECE_SIZE	4
+
+// Many standard games stepped together, for training agents. Actions for
+// every game go in at once, and observations of every game come out in
+// contiguous arrays, game after game, ready to be wrapped as tensors.
+// Everything is allocated up front, so stepping allocates nothing. The
+// games are shared out over a pool of threads.
+class BatchEnvironment
+{
+	public:
+		// ticksPerStep ticks are run for every action. 0 threads means one
+		// per processor.
+		BatchEnvironment(int games, int ticksPerStep = 1, int threads = 0);
+
+		int size() const;
+
+		// Start every game over, game i from seeds[i], or just one game
+		void reset(const unsigned int *seeds);
+		void reset(int game, unsigned int seed);
+
+		// Make actions[i] in game i, an ACTION_* or -1 to make no move, then
+		// tick. Finished games stay as they are, with no reward, until they
+		// are reset.
+		void step(const int *actions);
+
+		// Observations after the last reset or step, one entry per game
+		const unsigned char *boards() const;
+		const int *pieces() const;
+		const int *nextPieces() const;
+		const float *clearBarPositions() const;
+
+		// The score each game gained in the last step, and whether it has
+		// ended
+		const float *rewards() const;
+		const unsigned char *done() const;
+
+	private:
+		BatchEnvironment(const BatchEnvironment &);
+		BatchEnvironment &operator =(const BatchEnvironment &);
+
+		void stepGames(int first, int last, const int *actions);
+		void observe(int game);
+
+		int ticksPerStep;
+		ThreadPool pool;
+		std::vector<Game> games;
+
+		std::vector<unsigned char> boardData;
+		std::vector<int> pieceData, nextPieceData;
+		std::vector<float> clearBarData, rewardData;
+		std::vector<unsigned char> doneData;
+};
+
+// Step games games with moves drawn at random for steps steps and print
+// how many game steps a second that came to. Returns the process exit
+// status for lumines --env-benchmark.
+int runEnvironmentBenchmark(int games, int steps);
+
+#endif
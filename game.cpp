@@ -13,200 +13,335 @@
 //---------------------------------------------------------------------------
 
 #include <algorithm>
+#include <assert.h>
 
 #include "game.hpp"
-#include "viewer.hpp"
 #define XBLOCKCOL 1
 #define OBLOCKCOL 2
 #define XCLEARBLOCKCOL 3
 #define OCLEARBLOCKCOL 4
-#define COUNTER_SPACE 16
-int lastClearedRow = -1;
-int atTheTop = 0;
-static const Piece PIECES[] = {
-  Piece(
+
+// What each number hashed by zobristKey stands for
+#define HASH_CELL		0
+#define HASH_PIECE		(1 << 20)
+#define HASH_PIECE_X	(2 << 20)
+#define HASH_PIECE_Y	(3 << 20)
+#define HASH_NEXT_PIECE	(4 << 20)
+#define HASH_BAR		(5 << 20)
+static constexpr const char *PIECE_DESCS[] = {
         "...."
         ".xx."
         ".xx."
-        "....", 0,			1,1,1,1), // Blue
-  Piece(
+        "....", // Blue
         "...."
         ".xx."
         ".xo."
-        "....", 1,			1,1,1,1), // purple 
-  Piece(
+        "....", // purple 
         "...."
         ".xx."
         ".oo."
-        "....", 2,			1,1,1,1), // orange
-  Piece(
+        "....", // orange
         "...."
         ".ox."
         ".oo."
-        "....", 3,			1,1,1,1), // green
-  Piece(
+        "....", // green
         "...."
         ".oo."
         ".oo."
-        "....", 4,			1,1,1,1), // red
-  Piece(
+        "....", // red
         "...."
         ".xo."
         ".ox."
-        "....", 5,			1,1,1,1), // pink
+        "....", // pink
 /*
-  Piece(
         "...."
         ".xx."
         ".xx."
-        "....", 6,			1,1,1,1) // yellow*/
+        "....", // yellow*/
 };
 
-Piece::Piece(const char *desc, int cindex, 
-              int left, int top, int right, int bottom)
+// Cell (row, col) moves to (col, 3-row) when turned clockwise
+static constexpr unsigned short rotateMaskCW(unsigned short mask)
 {
-  std::copy(desc, desc + 16, desc_);
-  cindex_ = cindex;
-  margins_[0] = left;
-  margins_[1] = top;
-  margins_[2] = right;
-  margins_[3] = bottom;
+	unsigned short rotated = 0;
+	for (int row = 0; row < 4; ++row)
+		for (int col = 0; col < 4; ++col)
+			if (mask & (1 << (row*4 + col)))
+				rotated |= 1 << (col*4 + 3 - row);
+	return rotated;
 }
 
-Piece::Piece()
-{}
+// Every rotation of a 16 character description ('.', 'x' or 'o' per
+// cell, rows top to bottom) given the margins of the first. The tables
+// below are built by the compiler, so the masks are constants wherever
+// a piece is known.
+static constexpr PieceShape makePieceShape(const char *desc,
+	int left, int top, int right, int bottom)
+{
+	PieceShape shape = {};
+	for (int i = 0; i < 16; ++i)
+	{
+		if (desc[i] == 'x' || desc[i] == 'o')
+			shape.mask[0] |= 1 << i;
+		if (desc[i] == 'o')
+			shape.oMask[0] |= 1 << i;
+	}
+	
+	shape.margins[0][0] = left;
+	shape.margins[0][1] = top;
+	shape.margins[0][2] = right;
+	shape.margins[0][3] = bottom;
+	
+	// Turning clockwise the bottom margin becomes the left one, the left
+	// the top and so on
+	for (int r = 1; r < 4; ++r)
+	{
+		shape.mask[r] = rotateMaskCW(shape.mask[r-1]);
+		shape.oMask[r] = rotateMaskCW(shape.oMask[r-1]);
+		for (int m = 0; m < 4; ++m)
+			shape.margins[r][m] = shape.margins[r-1][(m + 3) % 4];
+	}
+	return shape;
+}
 
-Piece& Piece::operator =(const Piece& other)
+static constexpr PieceShape SHAPES[NUM_PIECES] = {
+  makePieceShape(PIECE_DESCS[0], 1,1,1,1),
+  makePieceShape(PIECE_DESCS[1], 1,1,1,1),
+  makePieceShape(PIECE_DESCS[2], 1,1,1,1),
+  makePieceShape(PIECE_DESCS[3], 1,1,1,1),
+  makePieceShape(PIECE_DESCS[4], 1,1,1,1),
+  makePieceShape(PIECE_DESCS[5], 1,1,1,1),
+};
+
+static constexpr Piece PIECES[] = {
+  Piece(&SHAPES[0], 0),
+  Piece(&SHAPES[1], 1),
+  Piece(&SHAPES[2], 2),
+  Piece(&SHAPES[3], 3),
+  Piece(&SHAPES[4], 4),
+  Piece(&SHAPES[5], 5),
+};
+
+const Piece &getStandardPiece(int index)
 {
-  std::copy(other.desc_, other.desc_ + 16, desc_);
-  std::copy(other.margins_, other.margins_ + 4, margins_);
-  cindex_ = other.cindex_;
-  return *this;
+  return PIECES[index];
 }
 
+Piece::Piece()
+  : shape_(&SHAPES[0]), rotation_(0), removed_(0), cindex_(0)
+{}
+
 int Piece::getLeftMargin() const
 {
-  return margins_[0];
+  return shape_->margins[rotation_][0];
 }
 
 int Piece::getTopMargin() const
 {
-  return margins_[1];
+  return shape_->margins[rotation_][1];
 }
 
 int Piece::getRightMargin() const
 {
-  return margins_[2];
+  return shape_->margins[rotation_][2];
 }
 
 int Piece::getBottomMargin() const
 {
-  return margins_[3];
+  return shape_->margins[rotation_][3];
 }
 
 int Piece::getColourIndex(int row, int col) const
 {
-	if (desc_[ row*4 + col ] == 'x')
-		return XBLOCKCOL;
-	else if (desc_[ row*4 + col ] == 'o')
-		return OBLOCKCOL;
+	if (!isOn(row, col))
+		return 0;
 	
-	return 0;
+	return (shape_->oMask[rotation_] & (1 << (row*4 + col))) ? OBLOCKCOL : XBLOCKCOL;
 }
 
 Piece Piece::rotateCW() const
 {
-  char ndesc[16];
-  getColumnRev(0, (char*)ndesc);
-  getColumnRev(1, (char*)(ndesc+4));
-  getColumnRev(2, (char*)(ndesc+8));
-  getColumnRev(3, (char*)(ndesc+12));
-
-  return Piece(ndesc, cindex_,
-		margins_[3], margins_[0], margins_[1], margins_[2]);
+	Piece rotated = *this;
+	rotated.rotation_ = (rotation_ + 1) & 3;
+	return rotated;
 }
 
 Piece Piece::rotateCCW() const
 {
-  char ndesc[16];
-  getColumn(3, (char*)ndesc);
-  getColumn(2, (char*)(ndesc+4));
-  getColumn(1, (char*)(ndesc+8));
-  getColumn(0, (char*)(ndesc+12));
-
-  return Piece(ndesc, cindex_,
-		margins_[1], margins_[2], margins_[3], margins_[0]);
+	Piece rotated = *this;
+	rotated.rotation_ = (rotation_ + 3) & 3;
+	return rotated;
 }
 
 bool Piece::isOn(int row, int col) const
 {
-  return desc_[ row*4 + col ] == 'x' || desc_[ row*4 + col ] == 'o';
+	return getMask() & (1 << (row*4 + col));
+}
+
+int Piece::getLook() const
+{
+	return getColourIndex(1, 1) << 6 | getColourIndex(2, 1) << 4
+		| getColourIndex(1, 2) << 2 | getColourIndex(2, 2);
 }
 
-void Piece::getColumn(int col, char *buf) const
+// The random number the hash of a game mixes in for a thing, one of the
+// HASH_* plus a number saying which. Worked out rather than looked up, so
+// wells of any size can be hashed, and the same on every machine. This is
+// splitmix64.
+static unsigned long long zobristKey(unsigned long long thing)
 {
-  buf[0] = desc_[col];
-  buf[1] = desc_[col+4];
-  buf[2] = desc_[col+8];
-  buf[3] = desc_[col+12];
+	unsigned long long z = thing + 0x9e3779b97f4a7c15ull;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
 }
 
-void Piece::getColumnRev(int col, char *buf) const
+static unsigned long long cellKey(int r, int c, int colour)
 {
-  buf[0] = desc_[col+12];
-  buf[1] = desc_[col+8];
-  buf[2] = desc_[col+4];
-  buf[3] = desc_[col];
+	return zobristKey(HASH_CELL + (r*32 + c)*8 + colour);
 }
 
-Game::Game(int width, int height)
-  : board_width_(width)
-	, board_height_(height)
+template <int W, int H>
+BasicGame<W, H>::BasicGame(int width, int height)
+  : counter(0)
+	, numBlocksCleared(0)
+	, board_width_(W ? W : width)
+	, board_height_(H ? H : height)
 	, stopped_(false)
-	, linesCleared_(0)
+	, rng_(rand())
+	, eventHead_(0)
+	, eventTail_(0)
 	, score_(0)
-	, numBlocksCleared(0)
-	, counter(0)
-{
-  int sz = board_width_ * (board_height_+4);
-  board_ = new int[ sz ];
-  std::fill(board_, board_ + sz, -1);
-nextPiece = PIECES[ rand() % 6 ];
+	, linesCleared_(0)
+	, clearBarPos(0)
+	, sweepStep_(0)
+	, lastClearedColumn_(-1)
+	, markedColumns_(0)
+	, atTheTop_(0)
+	, boardHash_(0)
+{
+  assert((!W || width == W) && (!H || height == H));
+  board_.assign(getWidth() * (getHeight()+4), -1);
+  rowBits_.assign(getHeight()+4, 0u);
+  heights_.assign(getWidth(), 0);
+nextPiece = PIECES[ random() % 6 ];
   generateNewPiece();
 }
 
-void Game::reset()
+template <int W, int H>
+void BasicGame<W, H>::reset()
 {
 	stopped_ = false;
-	std::fill(board_, board_ + (board_width_*(board_height_+4)), -1);
+	std::fill(board_.begin(), board_.end(), -1);
+	std::fill(rowBits_.begin(), rowBits_.end(), 0u);
+	std::fill(heights_.begin(), heights_.end(), 0);
+	boardHash_ = 0;
 	linesCleared_ = 0;
 	score_ = 0;
-	nextPiece = PIECES[ rand() % 6 ];
+	counter = 0;
+	numBlocksCleared = 0;
+	clearBarPos = 0;
+	sweepStep_ = 0;
+	lastClearedColumn_ = -1;
+	markedColumns_ = 0;
+	eventHead_ = eventTail_ = 0;
+	atTheTop_ = 0;
+	nextPiece = PIECES[ random() % 6 ];
 	generateNewPiece();
 }
 
-Game::~Game()
+template <int W, int H>
+void BasicGame<W, H>::reset(unsigned int seed)
+{
+	rng_ = seed;
+	reset();
+}
+
+template <int W, int H>
+int BasicGame<W, H>::random()
+{
+	rng_ = rng_ * 1103515245 + 12345;
+	return (rng_ >> 16) & 0x7fff;
+}
+
+template <int W, int H>
+void BasicGame<W, H>::pushEvent(int type, int r, int c, int value, int bonus)
+{
+	// When full the oldest event makes way
+	if (eventTail_ - eventHead_ == EVENT_QUEUE_SIZE)
+		eventHead_++;
+	
+	GameEvent &event = events_[eventTail_++ & (EVENT_QUEUE_SIZE - 1)];
+	event.type = type;
+	event.r = r;
+	event.c = c;
+	event.value = value;
+	event.bonus = bonus;
+}
+
+template <int W, int H>
+bool BasicGame<W, H>::pollEvent(GameEvent &event)
+{
+	if (eventHead_ == eventTail_)
+		return false;
+	event = events_[eventHead_++ & (EVENT_QUEUE_SIZE - 1)];
+	return true;
+}
+
+template <int W, int H>
+int BasicGame<W, H>::get(int r, int c) const
+{
+  return board_[ r*getWidth() + c ];
+}
+
+template <int W, int H>
+int& BasicGame<W, H>::get(int r, int c) 
 {
-  delete [] board_;
+  return board_[ r*getWidth() + c ];
 }
 
-int Game::get(int r, int c) const
+template <int W, int H>
+void BasicGame<W, H>::setCell(int r, int c, int colour)
 {
-  return board_[ r*board_width_ + c ];
+  int &cell = get(r, c);
+  if(cell == colour) {
+    return;
+  }
+  if(cell != -1) {
+    boardHash_ ^= cellKey(r, c, cell);
+  }
+  if(colour != -1) {
+    boardHash_ ^= cellKey(r, c, colour);
+  }
+  cell = colour;
 }
 
-int& Game::get(int r, int c) 
+template <int W, int H>
+unsigned long long BasicGame<W, H>::getHash() const
 {
-  return board_[ r*board_width_ + c ];
+	return boardHash_
+		^ zobristKey(HASH_PIECE + piece_.getLook())
+		^ zobristKey(HASH_PIECE_X + px_ + 16)
+		^ zobristKey(HASH_PIECE_Y + py_)
+		^ zobristKey(HASH_NEXT_PIECE + nextPiece.getLook())
+		^ zobristKey(HASH_BAR + sweepStep_ / TICKS_PER_COLUMN);
 }
 
-bool Game::doesPieceFit(const Piece& p, int x, int y) const
+// Line a row of a piece (bit c = column c of the piece) up with the
+// occupancy bits of the board row it lands on
+static unsigned int pieceRowAt(unsigned int cells, int x)
+{
+	return x >= 0 ? cells << x : cells >> -x;
+}
+
+template <int W, int H>
+bool BasicGame<W, H>::doesPieceFit(const Piece& p, int x, int y) const
 {
   if(x + p.getLeftMargin() < 0) {
     return false;
   }
 
-  if(x + 3 - p.getRightMargin() >= board_width_) {
+  if(x + 3 - p.getRightMargin() >= getWidth()) {
     return false;
   }
 
@@ -214,52 +349,50 @@ bool Game::doesPieceFit(const Piece& p, int x, int y) const
     return false;
   }
 
+  unsigned short mask = p.getMask();
   for(int r = 0; r < 4; ++r) {
-    for(int c = 0; c < 4; ++c) {
-      if(p.isOn(r, c)) {
-        if(get(y-r, x+c) != -1) {
-          return false;
-        }
-      }
+    unsigned int cells = (mask >> (r*4)) & 0xf;
+    if(cells && (rowBits_[y-r] & pieceRowAt(cells, x))) {
+      return false;
     }
   }
 
   return true;
 }
 
-void Game::removePiece(const Piece& p, int x, int y) 
+template <int W, int H>
+void BasicGame<W, H>::removeRow(int y)
 {
-  for(int r = 0; r < 4; ++r) {
-    for(int c = 0; c < 4; ++c) {
-      if(p.isOn(r, c)) {
-        get(y-r, x+c) = -1;
-      }
+  for(int c = 0; c < getWidth(); ++c) {
+    if(heights_[c] > y) {
+      --heights_[c];
     }
   }
-}
 
-void Game::removeRow(int y)
-{
-  for(int r = y + 1; r < board_height_ + 4; ++r) {
-    for(int c = 0; c < board_width_; ++c) {
-      get(r-1, c) = get(r, c);
+  for(int r = y + 1; r < getHeight() + 4; ++r) {
+    for(int c = 0; c < getWidth(); ++c) {
+      setCell(r-1, c, get(r, c));
     }
+    rowBits_[r-1] = rowBits_[r];
   }
 
-  for(int c = 0; c < board_width_; ++c) {
-    get(board_height_+3, c) = -1;
+  for(int c = 0; c < getWidth(); ++c) {
+    setCell(getHeight()+3, c, -1);
   }
+  rowBits_[getHeight()+3] = 0;
 }
 
-void Game::markBlocksForClearing() 
+template <int W, int H>
+void BasicGame<W, H>::markBlocksForClearing() 
 {
   // This method is implemented in a brain-dead way.  Repeatedly
   // walk up from the bottom of the well, removing the first full 
   // row, stopping when there are no more full rows.  It could be
   // made much faster.  Sue me.
-	for (int r = 0; r<board_height_ + 3; ++r)
+	int numMarked = 0;
+	for (int r = 0; r<getHeight() + 3; ++r)
 	{
-		for (int c = 0; c<board_width_ - 1; ++c)
+		for (int c = 0; c<getWidth() - 1; ++c)
 		{
 			for (int k = 1;k<3;k++)
 			{
@@ -269,82 +402,224 @@ void Game::markBlocksForClearing()
 					(get(r, c+1) == k || get(r, c+1) == l) && 
 					(get(r+1, c+1) == k || get(r+1, c+1) == l)) 
 				{
-					get(r, c) = l;
-					get(r+1, c) = l;
-					get(r, c+1) = l;
-					get(r+1, c+1) = l;
+					if (get(r, c) == k || get(r+1, c) == k || get(r, c+1) == k || get(r+1, c+1) == k)
+						numMarked++;
+					setCell(r, c, l);
+					setCell(r+1, c, l);
+					setCell(r, c+1, l);
+					setCell(r+1, c+1, l);
+					markedColumns_ |= 3u << c;
 				}
 			}
 		}
 	}
+	
+	if (numMarked)
+		pushEvent(GameEvent::SQUARES_MARKED, 0, 0, numMarked);
 }
 
-int Game::collapse()
+template <int W, int H>
+bool BasicGame<W, H>::isColumnMarked(int c) const
 {
-	int c = (int)clearBarPos;
-	if (c == lastClearedRow)
+	for (int r = 0; r < getHeight() + 3; ++r)
+		if (get(r, c) == XCLEARBLOCKCOL || get(r, c) == OCLEARBLOCKCOL)
+			return true;
+	return false;
+}
+
+template <int W, int H>
+int BasicGame<W, H>::clearColumn(int c)
+{
+	if (c >= getWidth() || c == lastClearedColumn_ || !(markedColumns_ & (1u << c)))
 		return 0;
 	
+	// Blocks level with the falling piece stay marked for another pass.
+	// Everything else that is marked goes, reported top down for the
+	// particle effects.
+	int top = getHeight() + 2;
 	int numClearedThisPass = 0;
-	for (int r = board_height_ + 2; r>= 0; --r)
-	{					
-		if ((get(r, c) == XCLEARBLOCKCOL || get(r, c) == OCLEARBLOCKCOL ) && r != py_)
+	for (int r = top; r >= 0; --r)
+	{
+		int col = get(r, c);
+		if ((col == XCLEARBLOCKCOL || col == OCLEARBLOCKCOL) && r != py_)
+		{
+			pushEvent(GameEvent::CELL_CLEARED, r, c, col);
+			numClearedThisPass++;
+		}
+	}
+	
+	if (numClearedThisPass)
+	{
+		// Slide everything that stays down over the gaps in one pass, up
+		// to the top row which only ever gets emptied
+		int dst = 0;
+		for (int r = 0; r < top; ++r)
+		{
+			int col = get(r, c);
+			if ((col != XCLEARBLOCKCOL && col != OCLEARBLOCKCOL) || r == py_)
+				setCell(dst++, c, col);
+		}
+		for (; dst < top; ++dst)
+			setCell(dst, c, -1);
+		if ((get(top, c) == XCLEARBLOCKCOL || get(top, c) == OCLEARBLOCKCOL) && top != py_)
+			setCell(top, c, -1);
+		heights_[c] -= numClearedThisPass;
+		
+		for (int r = 0; r <= top; ++r)
+		{
+			if (get(r, c) == -1)
+				rowBits_[r] &= ~(1u << c);
+			else
+				rowBits_[r] |= 1u << c;
+		}
+		
+		lastClearedColumn_ = c;
+		numBlocksCleared += numClearedThisPass;
+		for (int i = 0; i < numClearedThisPass; ++i)
 		{
-			// Collapse
-			ClearedBlock clr;
-			clr.r = r;
-			clr.c = c;
-			clr.col = get(r, c);
-			//viewer->addParticleBox(c, r, get(r,c)); 
-			blocksJustCleared.push_back(clr);
-			get(r, c) = -1;
-			pullDown(r, c);
-			lastClearedRow = c;
-			numBlocksCleared++;
 			score_ += (linesCleared_+10) / 10;
 			linesCleared_++;
-			numClearedThisPass++;
+			if (linesCleared_ % 100 == 0)
+				pushEvent(GameEvent::LEVEL_UP, 0, 0, linesCleared_ / 100);
 		}
 	}
-	// Pull pieces down
+	
+	if (!isColumnMarked(c))
+		markedColumns_ &= ~(1u << c);
 	return numClearedThisPass;
 }
 
-void Game::pullDown(int y, int x)
+template <int W, int H>
+int BasicGame<W, H>::sweepTick()
 {
-	for(int r = y + 1; r < board_height_+2; ++r) 
+	int cleared = clearColumn(sweepStep_ / TICKS_PER_COLUMN);
+	
+	// Past the right hand side, start over and score the whole sweep
+	if (sweepStep_ > getWidth() * TICKS_PER_COLUMN)
 	{
-		get(r-1, x) = get(r, x);
+		lastClearedColumn_ = -1;
+		sweepStep_ = 0;
+		int bonus = 0;
+		if (numBlocksCleared > 15)
+		{
+			int multiplier = numBlocksCleared / 4;
+			bonus = multiplier * (numBlocksCleared+10) / 10;
+			score_ += bonus;
+		}
+		pushEvent(GameEvent::SWEEP_FINISHED, 0, 0, numBlocksCleared, bonus);
+		numBlocksCleared = 0;
 	}
+	sweepStep_++;
+	clearBarPos = (double)sweepStep_ / TICKS_PER_COLUMN;
+	return cleared;
 }
-void Game::placePiece(const Piece& p, int x, int y)
+
+template <int W, int H>
+int BasicGame<W, H>::ticksToNextSweepEvent() const
 {
+	// The next marked column the bar hasn't already cleared in
+	int column = sweepStep_ / TICKS_PER_COLUMN;
+	unsigned int pending = column < getWidth() ? markedColumns_ & (~0u << column) : 0;
+	if (lastClearedColumn_ >= 0)
+		pending &= ~(1u << lastClearedColumn_);
+	if (pending)
+		return std::max(__builtin_ctz(pending) * TICKS_PER_COLUMN - sweepStep_, 0);
+	
+	// Otherwise the end of the sweep
+	return getWidth() * TICKS_PER_COLUMN + 1 - sweepStep_;
+}
+
+template <int W, int H>
+int BasicGame<W, H>::advanceSweep(int ticks)
+{
+	int cleared = 0;
+	while (ticks > 0)
+	{
+		int skip = std::min(ticksToNextSweepEvent(), ticks);
+		sweepStep_ += skip;
+		ticks -= skip;
+		if (ticks == 0)
+			break;
+		cleared += sweepTick();
+		ticks--;
+	}
+	clearBarPos = (double)sweepStep_ / TICKS_PER_COLUMN;
+	return cleared;
+}
+
+template <int W, int H>
+void BasicGame<W, H>::placePiece(const Piece& p, int x, int y)
+{
+  unsigned short mask = p.getMask();
   for(int r = 0; r < 4; ++r) {
+    unsigned int cells = (mask >> (r*4)) & 0xf;
+    if(!cells) {
+      continue;
+    }
     for(int c = 0; c < 4; ++c) {
-      if(p.isOn(r, c)) {
-        get(y-r, x+c) = p.getColourIndex(r, c);
+      if(cells & (1 << c)) {
+        setCell(y-r, x+c, p.getColourIndex(r, c));
+      }
+    }
+    rowBits_[y-r] |= pieceRowAt(cells, x);
+  }
+}
+
+template <int W, int H>
+void BasicGame<W, H>::settlePiece(const Piece& p, int x, int y)
+{
+  placePiece(p, x, y);
+
+  // The highest cell of the piece in each column is the new top of
+  // that column
+  unsigned short mask = p.getMask();
+  for(int c = 0; c < 4; ++c) {
+    for(int r = 0; r < 4; ++r) {
+      if(mask & (1 << (r*4 + c))) {
+        heights_[x+c] = std::max(heights_[x+c], y - r + 1);
+        break;
       }
     }
   }
 }
+
+template <int W, int H>
+int BasicGame<W, H>::landingRow(const Piece& p, int x) const
+{
+  // Settled blocks are stacked without gaps, so the piece comes to rest
+  // as soon as its lowest cell in some column meets the top of that
+  // column
+  unsigned short mask = p.getMask();
+  int y = 0;
+  for(int c = 0; c < 4; ++c) {
+    for(int r = 3; r >= 0; --r) {
+      if(mask & (1 << (r*4 + c))) {
+        y = std::max(y, heights_[x+c] + r);
+        break;
+      }
+    }
+  }
+  return y;
+}
 	
-void Game::generateNewPiece() 
+template <int W, int H>
+void BasicGame<W, H>::generateNewPiece() 
 {
 	piece_ = nextPiece;
-	nextPiece = PIECES[ rand() % 6 ];
+	nextPiece = PIECES[ random() % 6 ];
 
-  int xleft = (board_width_-3) / 2;
+  int xleft = (getWidth()-3) / 2;
 
   px_ = xleft;
-  py_ = board_height_ + 3 - piece_.getBottomMargin();
+  py_ = getHeight() + 3 - piece_.getBottomMargin();
 
 	sx_ = px_;
 	sy_ = py_;
-	
-  placePiece(piece_, px_, py_);
+	pushEvent(GameEvent::PIECE_SPAWNED, py_, px_);
 }
 
-int Game::tick()
+template <int W, int H>
+int BasicGame<W, H>::tick()
 {
 	if(stopped_) 
 	{
@@ -356,140 +631,114 @@ int Game::tick()
 	if (level > 12)
 		level = 12;
 		
-	removePiece(piece_, px_, py_);
 	markBlocksForClearing();
-	returnVal = collapse();
-	moveClearBar();
+	returnVal = sweepTick();
 	if (counter < COUNTER_SPACE - level)
 	{
 		counter++;
-		placePiece(piece_, px_, py_);
 		return returnVal;
 	}		
 
-	if (py_ == board_height_ + 2 && atTheTop < 16)
+	if (py_ == getHeight() + 2 && atTheTop_ < 16)
 	{
-		atTheTop++;
-		placePiece(piece_, px_, py_);
+		atTheTop_++;
 		return returnVal;
 	}
-	atTheTop = 0;
+	atTheTop_ = 0;
 	counter = 0;	
 	int ny = py_ - 1;
 		
 	if(!doesPieceFit(piece_, px_, ny)) 
 	{
 		// Must finish off with this piece
-		placePiece(piece_, px_, py_);
-		if(py_ >= board_height_ + 1) 
+		if(py_ >= getHeight() + 1) 
 		{
 	    	// you lose.
+			placePiece(piece_, px_, py_);
 	    	stopped_ = true;
+			pushEvent(GameEvent::GAME_OVER);
 	    	return -1;
 		} 
 		else
 		{
 			// break piece and keep moving down if need be
+			pushEvent(GameEvent::PIECE_LOCKED, py_, px_);
 
 			// The right side can drop more
-			if(get(ny-2, px_+1) != -1 && get(ny-2, px_+2) == -1)  
+			if(heights_[px_+1] > ny-2 && heights_[px_+2] <= ny-2)  
 			{												
 				dropPiece(0);
 				counter = COUNTER_SPACE;
 			}
-			else if(get(ny-2, px_+1) == -1 && get(ny-2, px_+2) != -1)  
+			else if(heights_[px_+1] <= ny-2 && heights_[px_+2] > ny-2)  
 			{
 				dropPiece(1);
 				counter = COUNTER_SPACE;
 			}
+			else
+			{
+				settlePiece(piece_, px_, py_);
+			}
 	    	generateNewPiece();
 	    	return returnVal;
 		}
 	}
 	else 
 	{
-		placePiece(piece_, px_, ny);
 		sy_ = py_;
 		py_ = ny;
 		return returnVal;
 	}
 }
 
-void Game::dropPiece(int side)
+template <int W, int H>
+void BasicGame<W, H>::dropPiece(int side)
 {
-	int ny = py_ - 1;
 	Piece temp = piece_;
 	temp.removeHalf((side + 1)%2);
-	removePiece(piece_, px_, py_);
-  	placePiece(temp, px_, py_);
-	while(true) 
-	{
-		if(get(ny-2, px_ + 1 + (side + 1)%2) != -1) 
-		{
-      		break;
-    	}
-		--ny;
-  	}
+  	settlePiece(temp, px_, py_);
 	piece_.removeHalf(side);
-	++ny;
-  	placePiece(piece_, px_, ny);
+	int ny = landingRow(piece_, px_);
+  	settlePiece(piece_, px_, ny);
+	pushEvent(GameEvent::PIECE_SPLIT, ny, px_, (side + 1)%2);
 }
-bool Game::moveLeft()
+template <int W, int H>
+bool BasicGame<W, H>::moveLeft()
 {
-  // Most of the piece movement methods work like this:
-  //  1. remove the piece from the board.
-  // 	2. does the piece fit in its new configuration?
-  //	3a. if yes, add it to the board in its new configuration.
-  //	3b. if no, put it back where it was.
-  // Simple and sort of silly, but satisfactory.
-
+  // The falling piece isn't in the board, so moving it is just a
+  // matter of checking it fits in its new configuration.
   int nx = px_ - 1;
 
-  removePiece(piece_, px_, py_);
   if(doesPieceFit(piece_, nx, py_)) {
-    placePiece(piece_, nx, py_);
     sx_ = px_;
 	px_ = nx;
     return true;
   } else {
-    placePiece(piece_, px_, py_);
     return false;
   }
 }
 
-bool Game::moveRight()
+template <int W, int H>
+bool BasicGame<W, H>::moveRight()
 {
   int nx = px_ + 1;
 
-  removePiece(piece_, px_, py_);
   if(doesPieceFit(piece_, nx, py_)) {
-    placePiece(piece_, nx, py_);
     sx_ = px_;
 	px_ = nx;
     return true;
   } else {
-    placePiece(piece_, px_, py_);
     return false;
   }
 }
 
-bool Game::drop()
+template <int W, int H>
+bool BasicGame<W, H>::drop()
 {
-  removePiece(piece_, px_, py_);
-  int ny = py_;
+  int ny = landingRow(piece_, px_);
 
-	while(true) 
-	{
-    	--ny;
-		score_ += 1 + (linesCleared_ / 100);
-    	if(!doesPieceFit(piece_, px_, ny)) 
-		{
-      		break;
-    	}
-  	}
-
-	++ny;
-  //	placePiece(piece_, px_, ny);
+	// Scored as if the piece had been walked down a row at a time
+	score_ += (py_ - ny + 1) * (1 + (linesCleared_ / 100));
 	if(ny == py_) 
 	{
     	return false;
@@ -504,59 +753,224 @@ bool Game::drop()
   	}
 }
 
-bool Game::rotateCW() 
+template <int W, int H>
+bool BasicGame<W, H>::rotateCW() 
 {
-	removePiece(piece_, px_, py_);
 	Piece npiece = piece_.rotateCW();
 
 	if(doesPieceFit(npiece, px_, py_)) 
 	{
-		placePiece(npiece, px_, py_);
 		piece_ = npiece;
 		return true;
 	} 
 	else 
 	{
-		placePiece(piece_, px_, py_);
 		return false;
 	}
 }
 
-bool Game::rotateCCW() 
+template <int W, int H>
+bool BasicGame<W, H>::rotateCCW() 
 {
-	removePiece(piece_, px_, py_);
 	Piece npiece = piece_.rotateCCW();
 	if(doesPieceFit(npiece, px_, py_)) 
 	{
-		placePiece(npiece, px_, py_);
 		piece_ = npiece;
 		return true;
 	} 
 	else 
 	{
-		placePiece(piece_, px_, py_);
 		return false;
 	}
 }
 
-bool Game::moveClearBar()
+template <int W, int H>
+int BasicGame<W, H>::getPieceCell(int r, int c) const
+{
+	int row = py_ - r;
+	int col = c - px_;
+	if (row < 0 || row > 3 || col < 0 || col > 3 || !piece_.isOn(row, col))
+		return -1;
+	return piece_.getColourIndex(row, col);
+}
+
+template <int W, int H>
+double BasicGame<W, H>::getFallFraction() const
+{
+	if (stopped_ || !doesPieceFit(piece_, px_, py_ - 1))
+		return 0;
+	
+	// The piece moves down on the tick after the counter fills up
+	int level = std::min(linesCleared_/100, 12);
+	return (double)std::min(counter, COUNTER_SPACE - level) / (COUNTER_SPACE - level + 1);
+}
+
+template <int W, int H>
+int BasicGame<W, H>::getGhostRow(int side) const
+{
+	// A piece that doesn't split lands on the same row on both sides, so
+	// each half can just be dropped on its own column
+	Piece half = piece_;
+	half.removeHalf((side + 1)%2);
+	return landingRow(half, px_);
+}
+
+template <int W, int H>
+int BasicGame<W, H>::getPlacements(Placement *placements) const
 {
-	if (clearBarPos > board_width_)
+	if (stopped_)
+		return 0;
+	
+	// Settled blocks have no gaps, so the piece can go anywhere it can be
+	// walked sideways to at the height it is at now
+	int left = px_, right = px_;
+	while (doesPieceFit(piece_, left - 1, py_))
+		left--;
+	while (doesPieceFit(piece_, right + 1, py_))
+		right++;
+	
+	// Colours of the cells of each rotation, left half first, skipping the
+	// ones that look like an earlier rotation
+	int turns[4], looks[4], cellColours[4][4];
+	int numRotations = 0;
+	Piece p = piece_;
+	for (int t = 0; t < 4; t++, p = p.rotateCW())
 	{
-		lastClearedRow = board_width_;
-		clearBarPos = 0;
-		if (numBlocksCleared > 15)
+		int look = p.getLook();
+		for (int k = 0; k < 4; k++)
+			cellColours[numRotations][k] = p.getColourIndex(1 + k % 2, 1 + k / 2);
+		if (std::find(looks, looks + numRotations, look) == looks + numRotations)
 		{
-			int multiplier = numBlocksCleared / 4;
-			score_ += multiplier * (numBlocksCleared+10) / 10;
+			turns[numRotations] = t;
+			looks[numRotations++] = look;
 		}
-		numBlocksCleared = 0;
+	}
+	
+	// Every column as bits by row, one set for each colour, marked or not.
+	// Only the cells that aren't empty need looking at.
+	unsigned long long colours[2][32] = {};
+	for (int r = 0; r < getHeight() + 4; r++)
+	{
+		for (unsigned int bits = rowBits_[r]; bits; bits &= bits - 1)
+		{
+			int c = __builtin_ctz(bits);
+			int col = get(r, c);
+			colours[col == OBLOCKCOL || col == OCLEARBLOCKCOL][c] |= 1ull << r;
+		}
+	}
+	
+	int n = 0;
+	for (int x = left; x <= right; x++)
+	{
+		// Where the halves land is the same for every rotation. Like tick(),
+		// a piece that can't get below the top rows stops there in one piece.
+		int whole = std::max(heights_[x+1], heights_[x+2]) + 2;
+		bool gameOver = whole >= getHeight() + 1;
+		int rows[2] = {
+			gameOver ? whole : heights_[x+1] + 2,
+			gameOver ? whole : heights_[x+2] + 2
+		};
 		
+		for (int i = 0; i < numRotations; i++)
+		{
+			Placement &placement = placements[n++];
+			placement.x = x;
+			placement.rotation = turns[i];
+			placement.landingRow[0] = rows[0];
+			placement.landingRow[1] = rows[1];
+			placement.gameOver = gameOver;
+			for (int k = 0; k < 4; k++)
+			{
+				placement.cellRow[k] = rows[k / 2] - 1 - k % 2;
+				placement.cellCol[k] = x + 1 + k / 2;
+				placement.cellColour[k] = cellColours[i][k];
+			}
+			countNewSquares(placement, colours);
+		}
 	}
-	clearBarPos += 0.2;
+	return n;
 }
 
-void Game::getNextPieceColour(int *col)
+// Count the squares in one pair of columns, one per bit of found, which
+// rarely has more than one or two set
+static void addSquares(Placement &placement, int column, unsigned long long found)
+{
+	if (!found)
+		return;
+	placement.squareColumns |= 1u << column;
+	for (; found; found &= found - 1)
+		placement.squares++;
+}
+
+template <int W, int H>
+void BasicGame<W, H>::countNewSquares(Placement &placement, const unsigned long long colours[2][32]) const
+{
+	// Square r in a pair of columns has its bottom cells in row r. Only
+	// those with one of the piece's cells in them can be new: the ones
+	// from a row below each half to its top row.
+	int left = placement.cellCol[0], right = placement.cellCol[2];
+	unsigned long long touched[2] = {
+		7ull << placement.cellRow[1] >> 1,
+		7ull << placement.cellRow[3] >> 1
+	};
+	
+	placement.squares = 0;
+	placement.squareColumns = 0;
+	for (int k = 0; k < 2; k++)
+	{
+		// Each half's column with the half in it
+		int colour = XBLOCKCOL + k;
+		unsigned long long l = colours[k][left], r = colours[k][right];
+		l |= (unsigned long long)(placement.cellColour[0] == colour) << placement.cellRow[0];
+		l |= (unsigned long long)(placement.cellColour[1] == colour) << placement.cellRow[1];
+		r |= (unsigned long long)(placement.cellColour[2] == colour) << placement.cellRow[2];
+		r |= (unsigned long long)(placement.cellColour[3] == colour) << placement.cellRow[3];
+		
+		unsigned long long both = l & r;
+		addSquares(placement, left, both & both >> 1 & (touched[0] | touched[1]));
+		if (left > 0)
+		{
+			both = colours[k][left - 1] & l;
+			addSquares(placement, left - 1, both & both >> 1 & touched[0]);
+		}
+		if (right < getWidth() - 1)
+		{
+			both = r & colours[k][right + 1];
+			addSquares(placement, right, both & both >> 1 & touched[1]);
+		}
+	}
+}
+
+template <int W, int H>
+void BasicGame<W, H>::applyPlacement(const Placement &placement)
+{
+	Piece p = piece_;
+	for (int t = 0; t < placement.rotation; t++)
+		p = p.rotateCW();
+	px_ = placement.x;
+	
+	if (placement.gameOver)
+	{
+		py_ = placement.landingRow[0];
+		placePiece(p, px_, py_);
+		stopped_ = true;
+		pushEvent(GameEvent::GAME_OVER);
+		return;
+	}
+	
+	for (int side = 0; side < 2; side++)
+	{
+		Piece half = p;
+		half.removeHalf((side + 1)%2);
+		settlePiece(half, px_, placement.landingRow[side]);
+	}
+	pushEvent(GameEvent::PIECE_LOCKED, placement.landingRow[0], px_);
+	counter = 0;
+	generateNewPiece();
+}
+
+template <int W, int H>
+void BasicGame<W, H>::getNextPieceColour(int *col)
 {
 	int counter = 0;
 	for (int i = 0; i < 2; i++)
@@ -569,3 +983,7 @@ void Game::getNextPieceColour(int *col)
 	}
 	
 }
+
+// The standard well, and any other size chosen at run time
+template class BasicGame<WELL_WIDTH, WELL_HEIGHT>;
+template class BasicGame<0, 0>;
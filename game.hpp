@@ -17,14 +17,83 @@
 
 #include <iostream>
 #include <vector>
-class Viewer;
+
+// Size of the standard well
+#define WELL_WIDTH 16
+#define WELL_HEIGHT 10
+
+// Ticks a piece waits before each move down at level 0, and ticks the
+// clear bar takes to cross a column
+#define COUNTER_SPACE 16
+#define TICKS_PER_COLUMN 5
+
+// Events a game holds on to until they are polled. Must be a power of two.
+#define EVENT_QUEUE_SIZE 256
+
+// Something that happened during a move or a tick. Which fields mean
+// anything depends on the type.
+struct GameEvent {
+	enum Type {
+		PIECE_SPAWNED,	// r, c: where the new piece starts
+		PIECE_LOCKED,	// r, c: where the piece came to rest
+		PIECE_SPLIT,	// value: the half that fell further (0 = left), r: where it landed
+		SQUARES_MARKED,	// value: number of squares newly marked
+		CELL_CLEARED,	// r, c: the cell, value: its colour before clearing
+		SWEEP_FINISHED,	// value: blocks cleared during the sweep, bonus: score bonus
+		LEVEL_UP,		// value: the new level, counting from 0
+		GAME_OVER
+	};
+	
+	int type;
+	int r, c;
+	int value;
+	int bonus;
+};
+
+// Most placements a piece can have: four rotations in each column of
+// the widest well
+#define MAX_PLACEMENTS (4 * 32)
+
+// One place the falling piece can end up, as found by getPlacements
+struct Placement {
+	// Where to steer the piece before letting it fall: px_ and the number
+	// of clockwise turns from the rotation it has now
+	int x;
+	int rotation;
+	
+	// Rows the left and right halves come to rest at, as for getGhostRow.
+	// They differ when the piece splits.
+	int landingRow[2];
+	
+	// The cells the piece fills and their colours: the left half, then
+	// the right, each top cell first
+	int cellRow[4], cellCol[4], cellColour[4];
+	
+	// Squares completed by the piece, which the next tick will mark, and
+	// bit c set for each column c one of them starts in
+	int squares;
+	unsigned int squareColumns;
+	
+	// The piece comes to rest too high and the game ends
+	bool gameOver;
+};
+
+// Every rotation of a piece, worked out once. Cell (row, col) of a 4x4
+// piece is bit row*4 + col of a mask.
+struct PieceShape {
+	// Cells the piece covers, and which of those are 'o' rather than 'x'
+	unsigned short mask[4];
+	unsigned short oMask[4];
+	// Empty columns/rows on the left, top, right and bottom
+	int margins[4][4];
+};
+
 class Piece {
 public:
 	Piece();
-	Piece(const char *desc, int cindex, 
-	       int left, int top, int right, int bottom);
-
-	Piece& operator =(const Piece& other);
+	constexpr Piece(const PieceShape *shape, int cindex)
+	  : shape_(shape), rotation_(0), removed_(0), cindex_(cindex)
+	{}
 
 	int getLeftMargin() const;
 	int getTopMargin() const;
@@ -32,49 +101,69 @@ public:
 	int getBottomMargin() const;
 	int getColourIndex(int row, int col) const;
 
+	// Rotations are looked up, nothing is recomputed
 	Piece rotateCW() const;
 	Piece rotateCCW() const;
 
 	bool isOn(int row, int col) const;
-	int margins_[4];
+	
+	// Colours of the 2x2 block in the middle as one number, the same for
+	// pieces that look the same whatever their shape and rotation
+	int getLook() const;
+	
+	// Occupied cells of the current rotation
+	unsigned short getMask() const
+	{
+		return shape_->mask[rotation_] & ~removed_;
+	}
+	
+	// Remove the left (0) or right (1) half of the 2x2 block in the
+	// middle. Only meant for a piece that has landed and won't turn again.
 	void removeHalf(int side)
 	{
-		// Remove left half
 		if (side == 0)
-		{
-			desc_[ 1*4 + 1 ] = '.';
-			desc_[ 2*4 + 1 ] = '.';
-		}
+			removed_ = (1 << (1*4 + 1)) | (1 << (2*4 + 1));
 		else
-		{
-			desc_[ 1*4 + 2 ] = '.';
-			desc_[ 2*4 + 2 ] = '.';
-		}
+			removed_ = (1 << (1*4 + 2)) | (1 << (2*4 + 2));
 	}
 	
 private:
-  void getColumn(int col, char *buf) const;
-  void getColumnRev(int col, char *buf) const;
-
-  char desc_[16];
+  const PieceShape *shape_;
+  int rotation_;
+  unsigned short removed_;
   int cindex_;
-//  int margins_[4];
 };
 
-class Game
+// The pieces games are made of. New pieces are picked between with the
+// game's random() % NUM_PIECES.
+#define NUM_PIECES 6
+const Piece &getStandardPiece(int index);
+
+// The game for a well W columns wide and H rows high. Knowing the size
+// at compile time lets the compiler unroll the loops over rows and
+// columns; a dimension of 0 means it is only known at run time. Use the
+// Game and DynamicGame typedefs below rather than this directly.
+template <int W, int H>
+class BasicGame
 {
 public:
   // Create a new game instance with a well of the given dimensions.
   // Note that internally, the board has four extra rows, to hold a 
-  // piece that has just begun to fall.
-  Game(int width, int height);
-
-  ~Game();
+  // piece that has just begun to fall. Dimensions fixed by W and H
+  // must match.
+  //
+  // Games can be copied, to try moves out on. A copy carries on exactly
+  // as the original would, events waiting to be polled included.
+  BasicGame(int width = W, int height = H);
 
   // Set the game to an initial state -- empty well, one piece waiting
   // on top.
   void reset();
 
+  // Same as reset(), but first reseed the piece generator. Two games
+  // reset with the same seed and fed the same moves play out identically.
+  void reset(unsigned int seed);
+
   // Advance the game by one tick.  This usually just pushes the 
   // currently falling piece down by one row.  It can sometimes cause
   // one or more rows to be filled and removed.  This method returns
@@ -99,15 +188,43 @@ public:
   bool rotateCW();
   bool rotateCCW();
 
-void dropShadowPiece();
+  // Where the left (0) or right (1) half of the falling piece will come
+  // to rest if it isn't moved again, as the y it would be placed at. The
+  // halves differ when the piece is going to split over uneven ground.
+  int getGhostRow(int side) const;
+
+  // Every place the falling piece can still be steered to and dropped,
+  // written to placements, which must have room for MAX_PLACEMENTS.
+  // Returns how many there are. Rotations that look the same are only
+  // listed once. Moves are taken to be quicker than the piece falls.
+  // The well can be at most 60 rows high.
+  int getPlacements(Placement *placements) const;
+
+  // Put the falling piece where getPlacements said it could go, as if it
+  // had been steered there and dropped, and bring on the next piece.
+  // Nothing else moves, so searches can look ahead without ticking.
+  void applyPlacement(const Placement &placement);
+
+  // Fingerprint of the game: every cell of the board, the falling piece
+  // and where it is, the next piece and the column the clear bar is in.
+  // Equal games hash the same on every machine. Only the board takes any
+  // work to hash, and that is kept up to date as cells change, so this
+  // is cheap enough to check every tick.
+  unsigned long long getHash() const;
+
+  // Number of settled blocks in column c
+  int getColumnHeight(int c) const
+  {
+    return heights_[c];
+  }
 
 	int getWidth() const
 	{ 
-		return board_width_;
+		return W ? W : board_width_;
 	}
 	int getHeight() const
 	{
-		return board_height_;
+		return H ? H : board_height_;
 	}
 
 	int getLinesCleared() const
@@ -128,30 +245,46 @@ void dropShadowPiece();
   // for r in [0,board_height_+4), not [0,board_height_].  The top four
   // rows are added on to accommodate new pieces that are falling into
   // the well.
+  // The falling piece isn't part of the board until it comes to rest.
   int get(int r, int c) const;
   int& get(int r, int c);
 
-	double getClearBarPos()
+  // Colour of the falling piece at row r and column c, as for get(), or
+  // -1 if the piece doesn't cover that cell.
+  int getPieceCell(int r, int c) const;
+
+  // How far the falling piece has got towards the row below, from 0 just
+  // after it moved to almost 1 just before it moves again. 0 if it can't
+  // fall any further.
+  double getFallFraction() const;
+
+	double getClearBarPos() const
 	{
 		return clearBarPos;
 	}
 	
-	bool moveClearBar();
-	void pullDown(int x, int y);
+	// The clear bar sweeps across the well one column every few ticks,
+	// removing the marked blocks in each column it passes over. This is
+	// how many ticks until it next does something: reaches a column with
+	// marked blocks, or runs off the right hand side and starts over.
+	int ticksToNextSweepEvent() const;
+	
+	// Move the clear bar on by the given number of ticks without moving
+	// anything else, jumping straight between sweep events. Returns the
+	// number of blocks cleared.
+	int advanceSweep(int ticks);
 			int sx_, sy_;
 			int px_;
 			int py_;
 			int counter;
-			struct ClearedBlock {
-				int r, c, col;
-			};
-			std::vector<ClearedBlock > blocksJustCleared;
+	
+	// Take the oldest event that hasn't been polled yet. Returns false if
+	// there are none. If nobody polls, only the newest EVENT_QUEUE_SIZE
+	// events are kept.
+	bool pollEvent(GameEvent &event);
+	
 	void markBlocksForClearing();
 	void dropPiece(int side);
-	void setViewer(Viewer *v)
-	{
-		viewer = v;
-	}
 		int numBlocksCleared;
 			Piece nextPiece;
 		void getNextPieceColour(int *col);
@@ -159,13 +292,29 @@ private:
 	bool doesPieceFit(const Piece& p, int x, int y) const;
 
 	void removeRow(int y);
-	int collapse();
+	
+	// One tick of the clear bar
+	int sweepTick();
+	int clearColumn(int c);
+	bool isColumnMarked(int c) const;
 
 
 
-  void removePiece(const Piece& p, int x, int y);
+  // Every change to the board goes through here, to keep its hash
+  void setCell(int r, int c, int colour);
+
   void placePiece(const Piece& p, int x, int y);
 
+  // Place a piece that has come to rest, raising the columns under it
+  void settlePiece(const Piece& p, int x, int y);
+
+  // Lowest y a piece dropped straight down in column x comes to rest at
+  int landingRow(const Piece& p, int x) const;
+
+  // Count the squares a placement completes, given bit r of colours[k][c]
+  // set for every cell (r, c) of colour k+1, marked or not
+  void countNewSquares(Placement &placement, const unsigned long long colours[2][32]) const;
+
   void generateNewPiece();
 
 
@@ -179,15 +328,50 @@ private:
 	Piece piece_;
 
 
-	int* board_;
+	std::vector<int> board_;
+	
+	// Bit c of row r is set if cell (r, c) isn't empty, so a piece can be
+	// tested against a row with one AND
+	std::vector<unsigned int> rowBits_;
+	
+	// Number of settled blocks in each column. Cleared blocks are always
+	// compacted away, so these are also the rows the columns are filled
+	// up to. The falling piece isn't counted.
+	std::vector<int> heights_;
+
+	// Piece generator state. The game keeps its own generator so that
+	// rand() calls elsewhere (particles etc.) don't change the pieces.
+	unsigned int rng_;
+	int random();
+	
+	// Events waiting to be polled, as a ring buffer
+	GameEvent events_[EVENT_QUEUE_SIZE];
+	unsigned int eventHead_, eventTail_;
+	void pushEvent(int type, int r = 0, int c = 0, int value = 0, int bonus = 0);
 
 	// Extra stuff
 	int score_, linesCleared_;
 
 	int numDeleted;
 	double clearBarPos;
-	Viewer *viewer;
 	
+	// Clear bar position in ticks, the column it last cleared blocks in
+	// during this sweep, and a bit per column that may hold marked blocks.
+	// The well can be at most 32 columns wide.
+	int sweepStep_;
+	int lastClearedColumn_;
+	unsigned int markedColumns_;
+	
+	// Ticks the stack has been up against the top of the well
+	int atTheTop_;
+	
+	// Zobrist hash of the board: the XOR of a random number for the
+	// colour of each cell that isn't empty
+	unsigned long long boardHash_;
 };
 
+// The standard well, and a well of any size
+typedef BasicGame<WELL_WIDTH, WELL_HEIGHT> Game;
+typedef BasicGame<0, 0> DynamicGame;
+
 #endif // CS488_GAME_HPP
@@ -0,0 +1,214 @@
+#include "glstate.hpp"
+
+GLStateCache::GLStateCache()
+{
+	invalidate();
+	resetCounters();
+}
+
+void GLStateCache::invalidate()
+{
+	for (int i = 0;i<NUM_CAPS;i++)
+		caps[i] = -1;
+	for (int i = 0;i<NUM_ARRAYS;i++)
+		clientStates[i] = -1;
+	for (int i = 0;i<GLSTATE_MAX_TEXTURE_UNITS;i++)
+	{
+		tex2D[i] = -1;
+		texCube[i] = -1;
+		bound2D[i] = -1;
+		boundCube[i] = -1;
+	}
+	unit = -1;
+	blendKnown = false;
+	program = -1;
+	arrayBuffer = -1;
+}
+
+int *GLStateCache::texTargetSlot(GLenum target, int *slots)
+{
+	// Texture enables are per texture unit. If we don't know which unit
+	// is active we can't track them.
+	if (unit < 0 || unit >= GLSTATE_MAX_TEXTURE_UNITS)
+		return 0;
+	if (target == GL_TEXTURE_2D || target == GL_TEXTURE_CUBE_MAP)
+		return &slots[unit];
+	return 0;
+}
+
+int GLStateCache::capIndex(GLenum cap)
+{
+	switch (cap)
+	{
+		case GL_BLEND:			return CAP_BLEND;
+		case GL_COLOR_MATERIAL:	return CAP_COLOR_MATERIAL;
+		case GL_DEPTH_TEST:		return CAP_DEPTH_TEST;
+		case GL_LIGHT0:			return CAP_LIGHT0;
+		case GL_LIGHTING:		return CAP_LIGHTING;
+		case GL_STENCIL_TEST:	return CAP_STENCIL_TEST;
+	}
+	return -1;
+}
+
+int GLStateCache::arrayIndex(GLenum array)
+{
+	switch (array)
+	{
+		case GL_VERTEX_ARRAY:			return ARRAY_VERTEX;
+		case GL_TEXTURE_COORD_ARRAY:	return ARRAY_TEXTURE_COORD;
+		case GL_NORMAL_ARRAY:			return ARRAY_NORMAL;
+	}
+	return -1;
+}
+
+bool GLStateCache::setCap(GLenum cap, int value)
+{
+	int *slot = 0;
+	if (cap == GL_TEXTURE_2D)
+		slot = texTargetSlot(cap, tex2D);
+	else if (cap == GL_TEXTURE_CUBE_MAP)
+		slot = texTargetSlot(cap, texCube);
+	else if (capIndex(cap) >= 0)
+		slot = &caps[capIndex(cap)];
+		
+	if (slot && *slot == value)
+	{
+		skipped++;
+		return false;
+	}
+	
+	if (slot)
+		*slot = value;
+	issued++;
+	return true;
+}
+
+void GLStateCache::enable(GLenum cap)
+{
+	if (setCap(cap, 1))
+		glEnable(cap);
+}
+
+void GLStateCache::disable(GLenum cap)
+{
+	if (setCap(cap, 0))
+		glDisable(cap);
+}
+
+void GLStateCache::activeTexture(GLenum newUnit)
+{
+	if (unit == (int)(newUnit - GL_TEXTURE0))
+	{
+		skipped++;
+		return;
+	}
+	unit = newUnit - GL_TEXTURE0;
+	issued++;
+	glActiveTexture(newUnit);
+}
+
+void GLStateCache::bindTexture(GLenum target, GLuint texture)
+{
+	long *slot = 0;
+	if (unit >= 0 && unit < GLSTATE_MAX_TEXTURE_UNITS)
+	{
+		if (target == GL_TEXTURE_2D)
+			slot = &bound2D[unit];
+		else if (target == GL_TEXTURE_CUBE_MAP)
+			slot = &boundCube[unit];
+	}
+	
+	if (slot && *slot == (long)texture)
+	{
+		skipped++;
+		return;
+	}
+	
+	if (slot)
+		*slot = texture;
+	issued++;
+	glBindTexture(target, texture);
+}
+
+void GLStateCache::blendFunc(GLenum sfactor, GLenum dfactor)
+{
+	if (blendKnown && blendSrc == sfactor && blendDst == dfactor)
+	{
+		skipped++;
+		return;
+	}
+	blendKnown = true;
+	blendSrc = sfactor;
+	blendDst = dfactor;
+	issued++;
+	glBlendFunc(sfactor, dfactor);
+}
+
+void GLStateCache::useProgram(GLuint newProgram)
+{
+	if (program == (long)newProgram)
+	{
+		skipped++;
+		return;
+	}
+	program = newProgram;
+	issued++;
+	glUseProgram(newProgram);
+}
+
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer)
+{
+	long *slot = target == GL_ARRAY_BUFFER ? &arrayBuffer : 0;
+	if (slot && *slot == (long)buffer)
+	{
+		skipped++;
+		return;
+	}
+	
+	if (slot)
+		*slot = buffer;
+	issued++;
+	glBindBuffer(target, buffer);
+}
+
+bool GLStateCache::setClientState(GLenum array, int value)
+{
+	int index = arrayIndex(array);
+	if (index >= 0 && clientStates[index] == value)
+	{
+		skipped++;
+		return false;
+	}
+	if (index >= 0)
+		clientStates[index] = value;
+	issued++;
+	return true;
+}
+
+void GLStateCache::enableClientState(GLenum array)
+{
+	if (setClientState(array, 1))
+		glEnableClientState(array);
+}
+
+void GLStateCache::disableClientState(GLenum array)
+{
+	if (setClientState(array, 0))
+		glDisableClientState(array);
+}
+
+unsigned long GLStateCache::getIssued() const
+{
+	return issued;
+}
+
+unsigned long GLStateCache::getSkipped() const
+{
+	return skipped;
+}
+
+void GLStateCache::resetCounters()
+{
+	issued = 0;
+	skipped = 0;
+}
@@ -0,0 +1,84 @@
+#ifndef GLSTATE_HPP
+#define GLSTATE_HPP
+
+#include <GL/gl.h>
+
+#define GLSTATE_MAX_TEXTURE_UNITS 4
+
+// Thin shadow of the OpenGL state that the renderer toggles most often.
+// Every call compares against what was last sent to GL and only forwards
+// the call if something actually changes. The cache starts out (and can
+// be reset to) "unknown", in which case the next call is always issued.
+class GLStateCache 
+{
+	public:
+		GLStateCache();
+		
+		// Forget everything we know about the GL state. Call this whenever
+		// GL may have been touched behind the cache's back.
+		void invalidate();
+		
+		void enable(GLenum cap);
+		void disable(GLenum cap);
+		void activeTexture(GLenum unit);
+		void bindTexture(GLenum target, GLuint texture);
+		void blendFunc(GLenum sfactor, GLenum dfactor);
+		void useProgram(GLuint program);
+		void bindBuffer(GLenum target, GLuint buffer);
+		void enableClientState(GLenum array);
+		void disableClientState(GLenum array);
+		
+		// Number of state changes sent to GL and skipped as redundant
+		// since the last resetCounters()
+		unsigned long getIssued() const;
+		unsigned long getSkipped() const;
+		void resetCounters();
+		
+	private:
+		bool setCap(GLenum cap, int value);
+		bool setClientState(GLenum array, int value);
+		
+		// The caps and client arrays the renderer toggles, which are all
+		// that is tracked. Anything else always goes through to GL.
+		enum Cap {
+			CAP_BLEND,
+			CAP_COLOR_MATERIAL,
+			CAP_DEPTH_TEST,
+			CAP_LIGHT0,
+			CAP_LIGHTING,
+			CAP_STENCIL_TEST,
+			NUM_CAPS
+		};
+		enum ClientArray {
+			ARRAY_VERTEX,
+			ARRAY_TEXTURE_COORD,
+			ARRAY_NORMAL,
+			NUM_ARRAYS
+		};
+		static int capIndex(GLenum cap);
+		static int arrayIndex(GLenum array);
+		int *texTargetSlot(GLenum target, int *slots);
+
+		// -1 = unknown, 0 = disabled, 1 = enabled
+		int caps[NUM_CAPS];
+		int tex2D[GLSTATE_MAX_TEXTURE_UNITS];
+		int texCube[GLSTATE_MAX_TEXTURE_UNITS];
+		
+		// -1 = unknown, otherwise the texture name
+		long bound2D[GLSTATE_MAX_TEXTURE_UNITS];
+		long boundCube[GLSTATE_MAX_TEXTURE_UNITS];
+		
+		int unit;
+		GLenum blendSrc, blendDst;
+		bool blendKnown;
+		
+		// -1 = unknown, otherwise the program name
+		long program;
+		
+		// Client arrays as for caps, and the array buffer as for program
+		int clientStates[NUM_ARRAYS];
+		long arrayBuffer;
+		
+		unsigned long issued, skipped;
+};
+#endif
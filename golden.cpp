@@ -0,0 +1,252 @@
+#include "golden.hpp"
+#include "renderer.hpp"
+#include "replay.hpp"
+#include "offscreen.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+#define GOLDEN_WIDTH		400
+#define GOLDEN_HEIGHT		300
+#define GOLDEN_TICKS		40
+
+// A pixel differs if its perceptual distance (0-255 scale) is above this,
+// and a frame fails if more than this fraction of its pixels differ
+#define PIXEL_THRESHOLD		8.0
+#define FAIL_FRACTION		0.001
+
+struct GoldenCase {
+	const char *name;
+	Renderer::DrawMode drawMode;
+	int options;
+};
+
+static const GoldenCase CASES[] = {
+	{ "wire",					Renderer::WIRE,				0 },
+	{ "wire-tex",				Renderer::WIRE,				Renderer::TEXTURES },
+	{ "face",					Renderer::FACE,				0 },
+	{ "face-tex",				Renderer::FACE,				Renderer::TEXTURES },
+	{ "face-tex-bump",			Renderer::FACE,				Renderer::TEXTURES | Renderer::BUMP_MAPPING },
+	{ "face-tex-trans",			Renderer::FACE,				Renderer::TEXTURES | Renderer::TRANSLUCENCY },
+	{ "face-tex-shadow",		Renderer::FACE,				Renderer::TEXTURES | Renderer::SHADOWS },
+	{ "multi",					Renderer::MULTICOLOURED,	0 },
+	{ "multi-tex",				Renderer::MULTICOLOURED,	Renderer::TEXTURES },
+	{ "multi-tex-bump-shadow",	Renderer::MULTICOLOURED,	Renderer::TEXTURES | Renderer::BUMP_MAPPING | Renderer::SHADOWS },
+};
+
+#define NUM_CASES (sizeof(CASES) / sizeof(CASES[0]))
+
+// Binary PPM, top row first. Pixels are kept bottom row first as GL
+// returns them, so rows are flipped on the way in and out.
+static bool writePPM(const std::string &filename, const std::vector<unsigned char> &pixels, int width, int height)
+{
+	FILE *file = fopen(filename.c_str(), "wb");
+	if (!file)
+		return false;
+		
+	fprintf(file, "P6\n%d %d\n255\n", width, height);
+	for (int y = height - 1;y>=0;y--)
+		fwrite(&pixels[y * width * 3], 1, width * 3, file);
+	
+	bool ok = !ferror(file);
+	fclose(file);
+	return ok;
+}
+
+static bool readPPM(const std::string &filename, std::vector<unsigned char> &pixels, int &width, int &height)
+{
+	FILE *file = fopen(filename.c_str(), "rb");
+	if (!file)
+		return false;
+		
+	int maxValue;
+	if (fscanf(file, "P6 %d %d %d", &width, &height, &maxValue) != 3 || maxValue != 255 || fgetc(file) == EOF)
+	{
+		fclose(file);
+		return false;
+	}
+	
+	pixels.resize(width * height * 3);
+	bool ok = true;
+	for (int y = height - 1;y>=0 && ok;y--)
+		ok = fread(&pixels[y * width * 3], 1, width * 3, file) == (size_t)width * 3;
+	
+	fclose(file);
+	return ok;
+}
+
+// Distance between two RGB colours, weighting brightness over hue the way
+// the eye does. Both are first averaged over a 2x2 block so that edges
+// which moved by a pixel aren't counted.
+static double pixelDistance(const std::vector<unsigned char> &a, const std::vector<unsigned char> &b, int width, int height, int x, int y)
+{
+	double diff[3] = { 0, 0, 0 };
+	int x1 = x + 1 < width ? x + 1 : x;
+	int y1 = y + 1 < height ? y + 1 : y;
+	int samples[4] = { (y * width + x) * 3, (y * width + x1) * 3, (y1 * width + x) * 3, (y1 * width + x1) * 3 };
+	
+	for (int i = 0;i<4;i++)
+		for (int c = 0;c<3;c++)
+			diff[c] += (a[samples[i] + c] - b[samples[i] + c]) / 4.0;
+	
+	double luma = 0.299 * diff[0] + 0.587 * diff[1] + 0.114 * diff[2];
+	double cb = -0.169 * diff[0] - 0.331 * diff[1] + 0.5 * diff[2];
+	double cr = 0.5 * diff[0] - 0.419 * diff[1] - 0.081 * diff[2];
+	return sqrt(luma * luma + 0.25 * (cb * cb + cr * cr));
+}
+
+// Fraction of pixels that differ. The diff image shows the rendered frame
+// darkened, with differing pixels in red.
+static double compareImages(const std::vector<unsigned char> &rendered, const std::vector<unsigned char> &golden, int width, int height, std::vector<unsigned char> &diff)
+{
+	int differing = 0;
+	diff.resize(rendered.size());
+	for (int y = 0;y<height;y++)
+	{
+		for (int x = 0;x<width;x++)
+		{
+			int i = (y * width + x) * 3;
+			if (pixelDistance(rendered, golden, width, height, x, y) > PIXEL_THRESHOLD)
+			{
+				differing++;
+				diff[i] = 255;
+				diff[i + 1] = 0;
+				diff[i + 2] = 0;
+			}
+			else
+			{
+				diff[i] = rendered[i] / 4;
+				diff[i + 1] = rendered[i + 1] / 4;
+				diff[i + 2] = rendered[i + 2] / 4;
+			}
+		}
+	}
+	return (double)differing / (width * height);
+}
+
+// Play the generated replay from a fresh renderer, rendering every tick so
+// that particles and animations advance as they would on screen
+static bool renderCase(const GoldenCase &c, const Replay &replay, std::vector<unsigned char> &pixels)
+{
+	// A new context per case so nothing carries over from the previous one
+	OffscreenContext offscreen;
+	if (!offscreen.create(GOLDEN_WIDTH, GOLDEN_HEIGHT))
+		return false;
+	
+	GameEngine engine;
+	Renderer renderer;
+	renderer.initGL();
+	renderer.resizeGL(GOLDEN_WIDTH, GOLDEN_HEIGHT);
+	renderer.setDrawMode(c.drawMode);
+	renderer.setRenderOptions(c.options);
+	renderer.startScreen = false;
+	engine.postReset(replay.seed);
+	srand(replay.seed);
+	
+	unsigned int nextEvent = 0;
+	for (int tick = 0;tick<GOLDEN_TICKS;tick++)
+	{
+		while (nextEvent < replay.events.size() && replay.events[nextEvent].tick <= tick)
+			engine.postAction(replay.events[nextEvent++].action);
+		engine.step();
+		renderer.setSnapshot(&engine.latest());
+		GameEvent event;
+		while (engine.pollEvent(event))
+			renderer.gameEvent(event);
+		renderer.renderFrame();
+	}
+	
+	glFinish();
+	offscreen.readPixels(pixels);
+	
+	GLenum error = glGetError();
+	if (error != GL_NO_ERROR)
+	{
+		std::cerr << "golden: " << c.name << ": GL error 0x" << std::hex << error << std::dec << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int runGoldenTests(const char *dir, bool update)
+{
+	Replay replay;
+	replay.generate(GOLDEN_TICKS);
+	if (update)
+		mkdir(dir, 0755);
+	
+	int failures = 0, missing = 0;
+	for (unsigned int i = 0;i<NUM_CASES;i++)
+	{
+		const GoldenCase &c = CASES[i];
+		std::string filename = std::string(dir) + "/" + c.name + ".ppm";
+		
+		std::vector<unsigned char> rendered;
+		if (!renderCase(c, replay, rendered))
+		{
+			std::cout << "FAIL   " << c.name << " (could not render)" << std::endl;
+			failures++;
+			continue;
+		}
+		
+		if (update)
+		{
+			if (!writePPM(filename, rendered, GOLDEN_WIDTH, GOLDEN_HEIGHT))
+			{
+				std::cout << "FAIL   " << c.name << " (could not write " << filename << ")" << std::endl;
+				failures++;
+			}
+			else
+				std::cout << "UPDATE " << c.name << std::endl;
+			continue;
+		}
+		
+		// A frame that was never recorded isn't a mismatch, so it is kept
+		// apart from the failures
+		struct stat info;
+		if (stat(filename.c_str(), &info) != 0)
+		{
+			std::cout << "MISSING " << c.name << " (no golden image " << filename << ")" << std::endl;
+			missing++;
+			continue;
+		}
+		
+		std::vector<unsigned char> golden;
+		int width, height;
+		if (!readPPM(filename, golden, width, height))
+		{
+			std::cout << "FAIL   " << c.name << " (could not read " << filename << ")" << std::endl;
+			failures++;
+			continue;
+		}
+		if (width != GOLDEN_WIDTH || height != GOLDEN_HEIGHT)
+		{
+			std::cout << "FAIL   " << c.name << " (golden image is " << width << "x" << height << ")" << std::endl;
+			failures++;
+			continue;
+		}
+		
+		std::vector<unsigned char> diff;
+		double fraction = compareImages(rendered, golden, width, height, diff);
+		if (fraction > FAIL_FRACTION)
+		{
+			std::cout << "FAIL   " << c.name << " (" << 100.0 * fraction << "% of pixels differ)" << std::endl;
+			writePPM(std::string(dir) + "/" + c.name + ".diff.ppm", diff, width, height);
+			failures++;
+		}
+		else
+			std::cout << "PASS   " << c.name << std::endl;
+	}
+	
+	std::cout << NUM_CASES - failures - missing << "/" << NUM_CASES << " frames match";
+	if (missing)
+		std::cout << ", " << missing << " have no golden image (run --golden-update)";
+	std::cout << std::endl;
+	if (failures)
+		return 1;
+	return missing ? GOLDEN_MISSING : 0;
+}
@@ -0,0 +1,23 @@
+#ifndef GOLDEN_HPP
+#define GOLDEN_HPP
+
+// Where the golden images are kept, relative to the source tree. The
+// ones checked in were recorded on Mesa's llvmpipe.
+#define GOLDEN_DIR		"golden"
+#define GOLDEN_MISSING	2
+
+// Render a fixed game in every draw mode with a few combinations of render
+// options and compare each frame against the golden image of the same name
+// in dir, e.g. dir/face-tex-shadow.ppm. Frames are compared perceptually so
+// that small rasterisation differences between drivers don't fail the run.
+//
+// With update set the golden images are rewritten instead of compared,
+// and dir is created if need be. Failing frames get a dir/<name>.diff.ppm
+// showing where they differ.
+//
+// Returns the process exit status: 0 if every frame matches, 1 if any
+// frame failed and GOLDEN_MISSING if the only trouble was frames with no
+// golden image to compare against.
+int runGoldenTests(const char *dir, bool update);
+
+#endif
@@ -1,9 +1,47 @@
 #include <gtkmm.h>
 #include <gtkglmm.h>
+#include <cstdlib>
+#include <cstring>
 #include "appwindow.hpp"
+#include "benchmark.hpp"
+#include "golden.hpp"
+#include "animation.hpp"
+#include "ai.hpp"
+#include "environment.hpp"
+#include "multigame.hpp"
 
 int main(int argc, char** argv)
 {
+  // lumines --benchmark FRAMES [REPLAY] renders offscreen and exits
+  // without ever opening a window
+  if (argc >= 3 && strcmp(argv[1], "--benchmark") == 0)
+    return runBenchmark(atoi(argv[2]), argc >= 4 ? argv[3] : NULL);
+
+  // lumines --golden [DIR] compares rendered frames against DIR's golden
+  // images, --golden-update [DIR] rewrites them
+  if (argc >= 2 && strcmp(argv[1], "--golden") == 0)
+    return runGoldenTests(argc >= 3 ? argv[2] : GOLDEN_DIR, false);
+  if (argc >= 2 && strcmp(argv[1], "--golden-update") == 0)
+    return runGoldenTests(argc >= 3 ? argv[2] : GOLDEN_DIR, true);
+
+  // lumines --autoplay GAMES [BEAM] lets the bot play for balancing runs
+  if (argc >= 3 && strcmp(argv[1], "--autoplay") == 0)
+    return runAutoPlay(atoi(argv[2]), argc >= 4 ? atoi(argv[3]) : 8);
+
+  // lumines --env-benchmark GAMES STEPS times the batched training environment
+  if (argc >= 4 && strcmp(argv[1], "--env-benchmark") == 0)
+    return runEnvironmentBenchmark(atoi(argv[2]), atoi(argv[3]));
+
+  // lumines --multigame-check GAMES TICKS checks the lockstep engine plays
+  // exactly as Game does, and times both
+  if (argc >= 4 && strcmp(argv[1], "--multigame-check") == 0)
+    return runMultiGameCheck(atoi(argv[2]), atoi(argv[3]));
+
+  // lumines --convert-animation IN.txt OUT.anim compiles a mascot animation
+  // into the binary clip format the game prefers
+  if (argc >= 4 && strcmp(argv[1], "--convert-animation") == 0)
+    return convertAnimation(argv[2], argv[3]);
+
   // Construct our main loop
   Gtk::Main kit(argc, argv);
 
@@ -13,6 +51,10 @@ int main(int argc, char** argv)
   // Construct our (only) window
   AppWindow window;
 
+  // lumines --record FILE saves each game played so it can be benchmarked
+  if (argc >= 3 && strcmp(argv[1], "--record") == 0)
+    window.setRecordFile(argv[2]);
+
   // And run the application!
   Gtk::Main::run(window);
 }
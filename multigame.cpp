@@ -0,0 +1,680 @@
+#include "multigame.hpp"
+#include "replay.hpp"
+#include <sys/time.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define MULTIGAME_AVX2
+#include <immintrin.h>
+#endif
+
+typedef unsigned short Rows[MULTIGAME_ROWS][MULTIGAME_LANES];
+
+static bool hasAvx2()
+{
+#ifdef MULTIGAME_AVX2
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+// Mark every cell that is part of a 2x2 square of one colour in the games
+// with live set to 0xffff, as Game::markBlocksForClearing. Only filled and
+// o are looked at, so marking as we go can't change what is found.
+static void markSquares(const Rows &filled, const Rows &o, Rows &marked, const unsigned short *live)
+{
+	for (int lane = 0;lane<MULTIGAME_LANES;lane++)
+	{
+		if (!live[lane])
+			continue;
+		for (int r = 0;r<MULTIGAME_ROWS - 1;r++)
+		{
+			unsigned int x0 = filled[r][lane] & ~o[r][lane], o0 = filled[r][lane] & o[r][lane];
+			unsigned int x1 = filled[r+1][lane] & ~o[r+1][lane], o1 = filled[r+1][lane] & o[r+1][lane];
+			unsigned int squares = (x0 & x1 & x0 >> 1 & x1 >> 1) | (o0 & o1 & o0 >> 1 & o1 >> 1);
+			marked[r][lane] |= squares | squares << 1;
+			marked[r+1][lane] |= squares | squares << 1;
+		}
+	}
+}
+
+// Clear the marked cells in the column with bit column[lane] set in each
+// game, other than those on row py[lane], as Game::clearColumn. The
+// number of cells cleared goes in cleared[lane].
+static void clearColumn(Rows &filled, Rows &o, Rows &marked,
+	const unsigned short *column, const unsigned short *py, unsigned short *cleared)
+{
+	int top = MULTIGAME_ROWS - 2;
+	for (int lane = 0;lane<MULTIGAME_LANES;lane++)
+	{
+		unsigned short bit = column[lane];
+		cleared[lane] = 0;
+		if (!bit)
+			continue;
+
+		int n = 0;
+		for (int r = 0;r<=top;r++)
+			if ((marked[r][lane] & bit) && r != py[lane])
+				n++;
+		if (!n)
+			continue;
+
+		int dst = 0;
+		for (int r = 0;r<top;r++)
+		{
+			if ((marked[r][lane] & bit) && r != py[lane])
+				continue;
+			filled[dst][lane] = (filled[dst][lane] & ~bit) | (filled[r][lane] & bit);
+			o[dst][lane] = (o[dst][lane] & ~bit) | (o[r][lane] & bit);
+			marked[dst][lane] = (marked[dst][lane] & ~bit) | (marked[r][lane] & bit);
+			dst++;
+		}
+		for (;dst<top;dst++)
+		{
+			filled[dst][lane] &= ~bit;
+			o[dst][lane] &= ~bit;
+			marked[dst][lane] &= ~bit;
+		}
+
+		// The top row is only ever emptied
+		if ((marked[top][lane] & bit) && top != py[lane])
+		{
+			filled[top][lane] &= ~bit;
+			o[top][lane] &= ~bit;
+			marked[top][lane] &= ~bit;
+		}
+		cleared[lane] = n;
+	}
+}
+
+#ifdef MULTIGAME_AVX2
+#define LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define STORE(p, v) _mm256_storeu_si256((__m256i *)(p), v)
+
+// The same as markSquares, a row of all 16 games at a time
+__attribute__((target("avx2")))
+static void markSquaresAvx2(const Rows &filled, const Rows &o, Rows &marked, const unsigned short *live)
+{
+	__m256i mask = LOAD(live);
+	__m256i f0 = LOAD(filled[0]), o0 = LOAD(o[0]);
+	__m256i below = _mm256_setzero_si256();
+	for (int r = 0;r<MULTIGAME_ROWS - 1;r++)
+	{
+		__m256i f1 = LOAD(filled[r+1]), o1 = LOAD(o[r+1]);
+		__m256i xs = _mm256_and_si256(_mm256_andnot_si256(o0, f0), _mm256_andnot_si256(o1, f1));
+		__m256i os = _mm256_and_si256(_mm256_and_si256(o0, f0), _mm256_and_si256(o1, f1));
+		xs = _mm256_and_si256(xs, _mm256_srli_epi16(xs, 1));
+		os = _mm256_and_si256(os, _mm256_srli_epi16(os, 1));
+		__m256i squares = _mm256_and_si256(_mm256_or_si256(xs, os), mask);
+		__m256i cells = _mm256_or_si256(squares, _mm256_slli_epi16(squares, 1));
+		STORE(marked[r], _mm256_or_si256(LOAD(marked[r]), _mm256_or_si256(cells, below)));
+		below = cells;
+		f0 = f1;
+		o0 = o1;
+	}
+	int last = MULTIGAME_ROWS - 1;
+	STORE(marked[last], _mm256_or_si256(LOAD(marked[last]), below));
+}
+
+// The same as clearColumn. The column in each game is turned into a word
+// with a bit per row, the cleared bits are squeezed out of that, lowest
+// first, and the word is put back.
+__attribute__((target("avx2")))
+static void clearColumnAvx2(Rows &filled, Rows &o, Rows &marked,
+	const unsigned short *column, const unsigned short *py, unsigned short *cleared)
+{
+	int top = MULTIGAME_ROWS - 2;
+	__m256i zero = _mm256_setzero_si256();
+	__m256i ones = _mm256_cmpeq_epi16(zero, zero);
+	__m256i bit = LOAD(column), pyRow = LOAD(py);
+
+	// Whether each lane of v has any bit of the column
+	#define IN_COLUMN(v) _mm256_andnot_si256(_mm256_cmpeq_epi16(_mm256_and_si256(v, bit), zero), ones)
+
+	__m256i f = zero, oc = zero, m = zero, gone = zero;
+	for (int r = 0;r<=top;r++)
+	{
+		__m256i row = _mm256_set1_epi16(1 << r);
+		__m256i clear = _mm256_andnot_si256(_mm256_cmpeq_epi16(pyRow, _mm256_set1_epi16(r)), IN_COLUMN(LOAD(marked[r])));
+		gone = _mm256_or_si256(gone, _mm256_and_si256(clear, row));
+		if (r < top)
+		{
+			f = _mm256_or_si256(f, _mm256_and_si256(IN_COLUMN(LOAD(filled[r])), row));
+			oc = _mm256_or_si256(oc, _mm256_and_si256(IN_COLUMN(LOAD(o[r])), row));
+			m = _mm256_or_si256(m, _mm256_and_si256(IN_COLUMN(LOAD(marked[r])), row));
+		}
+	}
+	if (_mm256_testz_si256(gone, gone))
+	{
+		STORE(cleared, zero);
+		return;
+	}
+
+	// The top row is only ever emptied
+	__m256i topRow = _mm256_set1_epi16(1 << top);
+	__m256i topGone = _mm256_andnot_si256(_mm256_cmpeq_epi16(_mm256_and_si256(gone, topRow), zero), ones);
+	__m256i count = _mm256_sub_epi16(zero, topGone);
+	gone = _mm256_andnot_si256(topRow, gone);
+	while (!_mm256_testz_si256(gone, gone))
+	{
+		__m256i lowest = _mm256_and_si256(gone, _mm256_sub_epi16(zero, gone));
+		__m256i keep = _mm256_sub_epi16(lowest, _mm256_set1_epi16(1));
+		f = _mm256_or_si256(_mm256_and_si256(f, keep), _mm256_andnot_si256(keep, _mm256_srli_epi16(f, 1)));
+		oc = _mm256_or_si256(_mm256_and_si256(oc, keep), _mm256_andnot_si256(keep, _mm256_srli_epi16(oc, 1)));
+		m = _mm256_or_si256(_mm256_and_si256(m, keep), _mm256_andnot_si256(keep, _mm256_srli_epi16(m, 1)));
+		count = _mm256_sub_epi16(count, _mm256_andnot_si256(_mm256_cmpeq_epi16(gone, zero), ones));
+		gone = _mm256_andnot_si256(keep, _mm256_srli_epi16(gone, 1));
+	}
+	STORE(cleared, count);
+
+	// Lanes with nothing to clear get back what they had
+	for (int r = 0;r<top;r++)
+	{
+		__m256i row = _mm256_set1_epi16(1 << r);
+		#define PUT_BACK(rows, v) STORE(rows[r], _mm256_or_si256(_mm256_andnot_si256(bit, LOAD(rows[r])), \
+			_mm256_and_si256(bit, _mm256_andnot_si256(_mm256_cmpeq_epi16(_mm256_and_si256(v, row), zero), ones))))
+		PUT_BACK(filled, f);
+		PUT_BACK(o, oc);
+		PUT_BACK(marked, m);
+		#undef PUT_BACK
+	}
+	__m256i emptied = _mm256_andnot_si256(_mm256_and_si256(bit, topGone), ones);
+	STORE(filled[top], _mm256_and_si256(LOAD(filled[top]), emptied));
+	STORE(o[top], _mm256_and_si256(LOAD(o[top]), emptied));
+	STORE(marked[top], _mm256_and_si256(LOAD(marked[top]), emptied));
+	#undef IN_COLUMN
+}
+
+#undef LOAD
+#undef STORE
+#endif
+
+MultiGame::MultiGame(int numGames)
+	: games(std::max(numGames, 0))
+	, groups((games + MULTIGAME_LANES - 1) / MULTIGAME_LANES)
+	, vectorised(hasAvx2())
+{
+	// Every standard piece is a 2x2 block, so only the colours differ
+	for (int i = 0;i<NUM_PIECES;i++)
+	{
+		Piece p = getStandardPiece(i);
+		for (int t = 0;t<4;t++, p = p.rotateCW())
+			for (int k = 0;k<4;k++)
+				pieceColours[i][t][k] = p.getColourIndex(1 + k / 2, 1 + k % 2);
+	}
+
+	for (int i = 0;i<games;i++)
+		reset(i, i);
+}
+
+int MultiGame::size() const
+{
+	return games;
+}
+
+bool MultiGame::isVectorised() const
+{
+	return vectorised;
+}
+
+void MultiGame::setVectorised(bool on)
+{
+	vectorised = on && hasAvx2();
+}
+
+void MultiGame::reset(int game, unsigned int seed)
+{
+	Group &group = groups[game / MULTIGAME_LANES];
+	int lane = game % MULTIGAME_LANES;
+
+	for (int r = 0;r<MULTIGAME_ROWS;r++)
+		group.filled[r][lane] = group.o[r][lane] = group.marked[r][lane] = 0;
+	for (int c = 0;c<WELL_WIDTH;c++)
+		group.heights[c][lane] = 0;
+	group.rng[lane] = seed;
+	group.counter[lane] = 0;
+	group.atTheTop[lane] = 0;
+	group.score[lane] = 0;
+	group.linesCleared[lane] = 0;
+	group.blocksCleared[lane] = 0;
+	group.sweepStep[lane] = 0;
+	group.lastClearedColumn[lane] = -1;
+	group.stopped[lane] = false;
+	group.nextPiece[lane] = random(group, lane) % NUM_PIECES;
+	generateNewPiece(group, lane);
+}
+
+int MultiGame::random(Group &group, int lane)
+{
+	group.rng[lane] = group.rng[lane] * 1103515245 + 12345;
+	return (group.rng[lane] >> 16) & 0x7fff;
+}
+
+void MultiGame::generateNewPiece(Group &group, int lane)
+{
+	group.piece[lane] = group.nextPiece[lane];
+	group.rotation[lane] = 0;
+	group.nextPiece[lane] = random(group, lane) % NUM_PIECES;
+	group.px[lane] = (WELL_WIDTH - 3) / 2;
+	group.py[lane] = WELL_HEIGHT + 2;
+}
+
+bool MultiGame::fits(const Group &group, int lane, int x, int y) const
+{
+	if (x < -1 || x + 2 >= WELL_WIDTH || y < 2)
+		return false;
+	return !((group.filled[y-1][lane] | group.filled[y-2][lane]) & (3u << (x + 1)));
+}
+
+void MultiGame::setCell(Group &group, int lane, int r, int c, int colour)
+{
+	unsigned short bit = 1 << c;
+	group.filled[r][lane] &= ~bit;
+	group.o[r][lane] &= ~bit;
+	group.marked[r][lane] &= ~bit;
+	if (colour > 0)
+	{
+		group.filled[r][lane] |= bit;
+		if (colour % 2 == 0)
+			group.o[r][lane] |= bit;
+		if (colour > 2)
+			group.marked[r][lane] |= bit;
+	}
+}
+
+// The left (0) or right (1) half of the piece, its top cell at row y-1
+void MultiGame::placeHalf(Group &group, int lane, int side, int y, bool settle)
+{
+	const int *colours = pieceColours[group.piece[lane]][group.rotation[lane]];
+	int c = group.px[lane] + 1 + side;
+	setCell(group, lane, y - 1, c, colours[side]);
+	setCell(group, lane, y - 2, c, colours[2 + side]);
+	if (settle)
+		group.heights[c][lane] = std::max(group.heights[c][lane], y);
+}
+
+int MultiGame::fall(Group &group, int lane, int level)
+{
+	if (group.counter[lane] < COUNTER_SPACE - level)
+	{
+		group.counter[lane]++;
+		return 0;
+	}
+
+	int px = group.px[lane], py = group.py[lane];
+	if (py == WELL_HEIGHT + 2 && group.atTheTop[lane] < 16)
+	{
+		group.atTheTop[lane]++;
+		return 0;
+	}
+	group.atTheTop[lane] = 0;
+	group.counter[lane] = 0;
+	int ny = py - 1;
+
+	if (fits(group, lane, px, ny))
+	{
+		group.py[lane] = ny;
+		return 0;
+	}
+
+	if (py >= WELL_HEIGHT + 1)
+	{
+		placeHalf(group, lane, 0, py, false);
+		placeHalf(group, lane, 1, py, false);
+		group.stopped[lane] = true;
+		return -1;
+	}
+
+	// A half over a lower column carries on down on its own
+	int left = group.heights[px+1][lane], right = group.heights[px+2][lane];
+	if (left > ny - 2 && right <= ny - 2)
+	{
+		placeHalf(group, lane, 0, py, true);
+		placeHalf(group, lane, 1, right + 2, true);
+		group.counter[lane] = COUNTER_SPACE;
+	}
+	else if (left <= ny - 2 && right > ny - 2)
+	{
+		placeHalf(group, lane, 1, py, true);
+		placeHalf(group, lane, 0, left + 2, true);
+		group.counter[lane] = COUNTER_SPACE;
+	}
+	else
+	{
+		placeHalf(group, lane, 0, py, true);
+		placeHalf(group, lane, 1, py, true);
+	}
+	generateNewPiece(group, lane);
+	return 0;
+}
+
+void MultiGame::tickGroup(Group &group, unsigned int lanes, int *results)
+{
+	unsigned short live[MULTIGAME_LANES], column[MULTIGAME_LANES];
+	unsigned short py[MULTIGAME_LANES], cleared[MULTIGAME_LANES];
+	int level[MULTIGAME_LANES];
+	for (int lane = 0;lane<MULTIGAME_LANES;lane++)
+	{
+		live[lane] = column[lane] = 0;
+		py[lane] = group.py[lane];
+		if (!(lanes & 1u << lane))
+			continue;
+		if (group.stopped[lane])
+		{
+			if (results)
+				results[lane] = -1;
+			continue;
+		}
+
+		live[lane] = 0xffff;
+		level[lane] = std::min(group.linesCleared[lane] / 100, 12);
+		int c = group.sweepStep[lane] / TICKS_PER_COLUMN;
+		if (c < WELL_WIDTH && c != group.lastClearedColumn[lane])
+			column[lane] = 1 << c;
+	}
+
+#ifdef MULTIGAME_AVX2
+	if (vectorised)
+	{
+		markSquaresAvx2(group.filled, group.o, group.marked, live);
+		clearColumnAvx2(group.filled, group.o, group.marked, column, py, cleared);
+	}
+	else
+#endif
+	{
+		markSquares(group.filled, group.o, group.marked, live);
+		clearColumn(group.filled, group.o, group.marked, column, py, cleared);
+	}
+
+	// The rest of the tick, as Game::sweepTick and the end of Game::tick
+	for (int lane = 0;lane<MULTIGAME_LANES;lane++)
+	{
+		if (!live[lane])
+			continue;
+
+		int n = cleared[lane];
+		if (n)
+		{
+			int c = __builtin_ctz(column[lane]);
+			group.heights[c][lane] -= n;
+			group.lastClearedColumn[lane] = c;
+			group.blocksCleared[lane] += n;
+			for (int i = 0;i<n;i++)
+				group.score[lane] += (group.linesCleared[lane]++ + 10) / 10;
+		}
+
+		if (group.sweepStep[lane] > WELL_WIDTH * TICKS_PER_COLUMN)
+		{
+			group.lastClearedColumn[lane] = -1;
+			group.sweepStep[lane] = 0;
+			int blocks = group.blocksCleared[lane];
+			if (blocks > 15)
+				group.score[lane] += blocks / 4 * (blocks + 10) / 10;
+			group.blocksCleared[lane] = 0;
+		}
+		group.sweepStep[lane]++;
+
+		int result = fall(group, lane, level[lane]);
+		if (results)
+			results[lane] = result < 0 ? -1 : n;
+	}
+}
+
+void MultiGame::tick(int *results)
+{
+	for (unsigned int g = 0;g<groups.size();g++)
+	{
+		int first = g * MULTIGAME_LANES;
+		int count = std::min(games - first, MULTIGAME_LANES);
+		tickGroup(groups[g], (1u << count) - 1, results ? results + first : NULL);
+	}
+}
+
+bool MultiGame::drop(Group &group, int lane)
+{
+	int px = group.px[lane];
+	int ny = std::max(group.heights[px+1][lane], group.heights[px+2][lane]) + 2;
+	group.score[lane] += (group.py[lane] - ny + 1) * (1 + group.linesCleared[lane] / 100);
+	if (ny == group.py[lane])
+		return false;
+	group.py[lane] = ny;
+	group.counter[lane] = COUNTER_SPACE;
+	return true;
+}
+
+bool MultiGame::move(int game, int action)
+{
+	Group &group = groups[game / MULTIGAME_LANES];
+	int lane = game % MULTIGAME_LANES;
+	int px = group.px[lane], py = group.py[lane];
+	switch (action)
+	{
+		case ACTION_LEFT:
+			if (!fits(group, lane, px - 1, py))
+				return false;
+			group.px[lane]--;
+			return true;
+		case ACTION_RIGHT:
+			if (!fits(group, lane, px + 1, py))
+				return false;
+			group.px[lane]++;
+			return true;
+		case ACTION_ROTATE_CCW:
+		case ACTION_ROTATE_CW:
+			if (!fits(group, lane, px, py))
+				return false;
+			group.rotation[lane] = (group.rotation[lane] + (action == ACTION_ROTATE_CW ? 1 : 3)) & 3;
+			return true;
+		case ACTION_DROP:
+			if (!drop(group, lane))
+				return false;
+			tickGroup(group, 1u << lane, NULL);
+			return true;
+	}
+	return false;
+}
+
+void MultiGame::step(const int *actions, int *results)
+{
+	// Pieces that were dropped all tick together first, as each Game's
+	// drop() would tick it
+	for (unsigned int g = 0;g<groups.size();g++)
+	{
+		unsigned int dropped = 0;
+		for (int lane = 0;lane<MULTIGAME_LANES;lane++)
+		{
+			int game = g * MULTIGAME_LANES + lane;
+			if (game >= games)
+				break;
+			if (actions[game] == ACTION_DROP)
+			{
+				if (drop(groups[g], lane))
+					dropped |= 1u << lane;
+			}
+			else if (actions[game] >= 0)
+				move(game, actions[game]);
+		}
+		if (dropped)
+			tickGroup(groups[g], dropped, NULL);
+	}
+	tick(results);
+}
+
+int MultiGame::get(int game, int r, int c) const
+{
+	const Group &group = groups[game / MULTIGAME_LANES];
+	int lane = game % MULTIGAME_LANES;
+	unsigned short bit = 1 << c;
+	if (!(group.filled[r][lane] & bit))
+		return -1;
+	return 1 + !!(group.o[r][lane] & bit) + 2 * !!(group.marked[r][lane] & bit);
+}
+
+int MultiGame::getPieceCell(int game, int r, int c) const
+{
+	const Group &group = groups[game / MULTIGAME_LANES];
+	int lane = game % MULTIGAME_LANES;
+	int row = group.py[lane] - r;
+	int col = c - group.px[lane];
+	if (row < 1 || row > 2 || col < 1 || col > 2)
+		return -1;
+	return pieceColours[group.piece[lane]][group.rotation[lane]][(row - 1) * 2 + col - 1];
+}
+
+int MultiGame::getPieceX(int game) const
+{
+	return groups[game / MULTIGAME_LANES].px[game % MULTIGAME_LANES];
+}
+
+int MultiGame::getPieceY(int game) const
+{
+	return groups[game / MULTIGAME_LANES].py[game % MULTIGAME_LANES];
+}
+
+void MultiGame::getNextPieceColour(int game, int *col) const
+{
+	const Group &group = groups[game / MULTIGAME_LANES];
+	memcpy(col, pieceColours[group.nextPiece[game % MULTIGAME_LANES]][0], 4 * sizeof(int));
+}
+
+int MultiGame::getColumnHeight(int game, int c) const
+{
+	return groups[game / MULTIGAME_LANES].heights[c][game % MULTIGAME_LANES];
+}
+
+int MultiGame::getScore(int game) const
+{
+	return groups[game / MULTIGAME_LANES].score[game % MULTIGAME_LANES];
+}
+
+int MultiGame::getLinesCleared(int game) const
+{
+	return groups[game / MULTIGAME_LANES].linesCleared[game % MULTIGAME_LANES];
+}
+
+double MultiGame::getClearBarPos(int game) const
+{
+	return (double)groups[game / MULTIGAME_LANES].sweepStep[game % MULTIGAME_LANES] / TICKS_PER_COLUMN;
+}
+
+bool MultiGame::isGameOver(int game) const
+{
+	return groups[game / MULTIGAME_LANES].stopped[game % MULTIGAME_LANES];
+}
+
+static double currentTime()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+// What differs between game i and a Game, or NULL if nothing does
+static const char *compareGame(const MultiGame &multi, int i, Game &game)
+{
+	for (int r = 0;r<MULTIGAME_ROWS;r++)
+		for (int c = 0;c<WELL_WIDTH;c++)
+			if (multi.get(i, r, c) != game.get(r, c))
+				return "board";
+	if (multi.getPieceX(i) != game.px_ || multi.getPieceY(i) != game.py_)
+		return "piece position";
+	for (int k = 0;k<4;k++)
+	{
+		int r = game.py_ - 1 - k / 2, c = game.px_ + 1 + k % 2;
+		if (multi.getPieceCell(i, r, c) != game.getPieceCell(r, c))
+			return "piece";
+	}
+	int next[4], expected[4];
+	multi.getNextPieceColour(i, next);
+	game.getNextPieceColour(expected);
+	if (memcmp(next, expected, sizeof(next)))
+		return "next piece";
+	for (int c = 0;c<WELL_WIDTH;c++)
+		if (multi.getColumnHeight(i, c) != game.getColumnHeight(c))
+			return "column heights";
+	if (multi.getScore(i) != game.getScore() || multi.getLinesCleared(i) != game.getLinesCleared())
+		return "score";
+	if (multi.getClearBarPos(i) != game.getClearBarPos())
+		return "clear bar";
+	return NULL;
+}
+
+int runMultiGameCheck(int games, int ticks)
+{
+	if (games < 1 || ticks < 1)
+	{
+		std::cerr << "multigame-check: game and tick counts must be positive" << std::endl;
+		return 1;
+	}
+
+	for (int pass = 0;pass<2;pass++)
+	{
+		MultiGame multi(games);
+		multi.setVectorised(pass == 0);
+		if (pass == 0 && !multi.isVectorised())
+			continue;
+		const char *name = multi.isVectorised() ? "avx2" : "plain";
+
+		std::vector<Game> single(games);
+		for (int i = 0;i<games;i++)
+		{
+			multi.reset(i, i + 1);
+			single[i].reset(i + 1);
+		}
+
+		// Moves as for --env-benchmark. Games that end start over from a
+		// new seed, so that the check never runs out of game.
+		std::vector<int> actions(games), results(games), expected(games);
+		unsigned int state = 12345;
+		unsigned int nextSeed = games + 1;
+		double multiTime = 0, singleTime = 0;
+		int finished = 0;
+		for (int t = 0;t<ticks;t++)
+		{
+			for (int i = 0;i<games;i++)
+			{
+				state = state * 1103515245 + 12345;
+				int r = (state >> 16) & 0x7fff;
+				actions[i] = r % 3 == 0 ? (r / 3) % NUM_ACTIONS : -1;
+			}
+
+			double start = currentTime();
+			for (int i = 0;i<games;i++)
+			{
+				if (actions[i] >= 0)
+					applyAction(&single[i], actions[i]);
+				expected[i] = single[i].tick();
+			}
+			double middle = currentTime();
+			multi.step(actions.data(), results.data());
+			multiTime += currentTime() - middle;
+			singleTime += middle - start;
+
+			for (int i = 0;i<games;i++)
+			{
+				const char *what = results[i] != expected[i] ? "tick result" : compareGame(multi, i, single[i]);
+				if (what)
+				{
+					std::cerr << "multigame-check: " << name << ": game " << i << " differs from Game in its "
+							  << what << " after tick " << t << std::endl;
+					return 1;
+				}
+				if (expected[i] < 0)
+				{
+					multi.reset(i, nextSeed);
+					single[i].reset(nextSeed++);
+					finished++;
+				}
+			}
+		}
+
+		std::cout << "multigame-check: " << name << ": " << games << " games the same as Game for "
+				  << ticks << " ticks, " << finished << " games finished, "
+				  << (long)((double)games * ticks / multiTime) << " game ticks a second against "
+				  << (long)((double)games * ticks / singleTime) << std::endl;
+	}
+	return 0;
+}
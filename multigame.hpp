@@ -0,0 +1,116 @@
+#ifndef MULTIGAME_HPP
+#define MULTIGAME_HPP
+
+#include <vector>
+
+#include "game.hpp"
+
+// Games are kept in groups of this many, one per 16 bit lane of an AVX2
+// register
+#define MULTIGAME_LANES		16
+#define MULTIGAME_ROWS		(WELL_HEIGHT + 4)
+
+// Many standard games played in lockstep, for self-play on a large scale.
+// Each game plays out exactly as a Game reset with the same seed and
+// given the same moves would, tick for tick, but there are no events.
+//
+// A row of a well is 16 bits, one per column, so the same row of 16
+// games fills an AVX2 register. Every cell is held as three such rows:
+// whether it is filled, whether it is an 'o' rather than an 'x' and
+// whether it is marked for clearing. Finding squares and clearing the
+// column under the clear bar, which is most of the work of a tick, is
+// then done for all 16 games at once. Where the processor has no AVX2
+// the same thing is done a game at a time.
+class MultiGame
+{
+	public:
+		// Game i starts out reset with seed i
+		MultiGame(int games);
+
+		int size() const;
+
+		// As Game::reset(seed)
+		void reset(int game, unsigned int seed);
+
+		// As Game::tick() on every game. results[i], if results isn't
+		// NULL, gets what game i's tick returned.
+		void tick(int *results = NULL);
+
+		// As applyAction with actions[i] on game i, -1 for no move, and
+		// then tick()
+		void step(const int *actions, int *results = NULL);
+
+		// As applyAction on one game. A drop ticks the game, as it would a
+		// Game.
+		bool move(int game, int action);
+
+		// As the Game methods of the same names
+		int get(int game, int r, int c) const;
+		int getPieceCell(int game, int r, int c) const;
+		int getPieceX(int game) const;
+		int getPieceY(int game) const;
+		void getNextPieceColour(int game, int *col) const;
+		int getColumnHeight(int game, int c) const;
+		int getScore(int game) const;
+		int getLinesCleared(int game) const;
+		double getClearBarPos(int game) const;
+		bool isGameOver(int game) const;
+
+		// Whether the AVX2 code is used, which it is wherever the processor
+		// has it. Turning it off, to compare the two, runs the plain code.
+		bool isVectorised() const;
+		void setVectorised(bool on);
+
+	private:
+		// Everything about 16 games, each thing an array with one entry
+		// per game
+		struct Group {
+			unsigned short filled[MULTIGAME_ROWS][MULTIGAME_LANES];
+			unsigned short o[MULTIGAME_ROWS][MULTIGAME_LANES];
+			unsigned short marked[MULTIGAME_ROWS][MULTIGAME_LANES];
+			int heights[WELL_WIDTH][MULTIGAME_LANES];
+
+			int px[MULTIGAME_LANES], py[MULTIGAME_LANES];
+			int piece[MULTIGAME_LANES], rotation[MULTIGAME_LANES];
+			int nextPiece[MULTIGAME_LANES];
+			int counter[MULTIGAME_LANES], atTheTop[MULTIGAME_LANES];
+			int score[MULTIGAME_LANES], linesCleared[MULTIGAME_LANES];
+			int blocksCleared[MULTIGAME_LANES];
+			int sweepStep[MULTIGAME_LANES], lastClearedColumn[MULTIGAME_LANES];
+			unsigned int rng[MULTIGAME_LANES];
+			bool stopped[MULTIGAME_LANES];
+		};
+
+		// Tick the games in a group with a bit set in lanes
+		void tickGroup(Group &group, unsigned int lanes, int *results);
+
+		// The piece's move down, once squares have been found and the clear
+		// bar has moved on, as the end of Game::tick()
+		int fall(Group &group, int lane, int level);
+
+		// Game::drop() up to the tick it ends with. Returns whether the
+		// piece moved.
+		bool drop(Group &group, int lane);
+
+		bool fits(const Group &group, int lane, int x, int y) const;
+		void setCell(Group &group, int lane, int r, int c, int colour);
+		void placeHalf(Group &group, int lane, int side, int y, bool settle);
+		void generateNewPiece(Group &group, int lane);
+		int random(Group &group, int lane);
+
+		int games;
+		std::vector<Group> groups;
+		bool vectorised;
+
+		// Colours of the 2x2 block of each piece in each rotation: top left,
+		// top right, bottom left, bottom right
+		int pieceColours[NUM_PIECES][4][4];
+};
+
+// Play games games for ticks ticks each way, with moves drawn at random,
+// and check every game stays the same as a Game after every tick. Both
+// the AVX2 and the plain code are checked where the processor has AVX2.
+// Returns the process exit status for lumines --multigame-check.
+int runMultiGameCheck(int games, int ticks);
+
+#endif
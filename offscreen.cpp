@@ -0,0 +1,135 @@
+#include "offscreen.hpp"
+#include <EGL/eglext.h>
+#include <GL/glext.h>
+#include <iostream>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+OffscreenContext::OffscreenContext()
+	: display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT), framebuffer(0), width(0), height(0)
+{
+	renderbuffers[0] = renderbuffers[1] = 0;
+}
+
+OffscreenContext::~OffscreenContext()
+{
+	destroy();
+}
+
+bool OffscreenContext::create(int w, int h)
+{
+	destroy();
+	
+	// Prefer Mesa's surfaceless platform so we never need an X server, and
+	// fall back to the default display
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay)
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if (display == EGL_NO_DISPLAY)
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+	{
+		std::cerr << "offscreen: no EGL display" << std::endl;
+		display = EGL_NO_DISPLAY;
+		return false;
+	}
+	
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cerr << "offscreen: EGL has no desktop OpenGL" << std::endl;
+		destroy();
+		return false;
+	}
+	
+	// We never draw to an EGL surface, but the config has to be one a
+	// surfaceless display has: those only offer pbuffers, and the default
+	// is a window
+	const EGLint configAttribs[] = {
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint numConfigs = 0;
+	if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs < 1)
+	{
+		std::cerr << "offscreen: no usable EGL config" << std::endl;
+		destroy();
+		return false;
+	}
+	
+	context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+	{
+		std::cerr << "offscreen: could not make a GL context current" << std::endl;
+		destroy();
+		return false;
+	}
+	
+	// Stands in for the window's back buffer, with the depth and stencil
+	// bits the shadow volumes need
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	
+	glGenRenderbuffers(2, renderbuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+	
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, w, h);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+	
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "offscreen: incomplete framebuffer" << std::endl;
+		destroy();
+		return false;
+	}
+	
+	glDrawBuffer(GL_COLOR_ATTACHMENT0);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	width = w;
+	height = h;
+	return true;
+}
+
+void OffscreenContext::destroy()
+{
+	if (context != EGL_NO_CONTEXT)
+	{
+		if (framebuffer)
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glDeleteRenderbuffers(2, renderbuffers);
+			glDeleteFramebuffers(1, &framebuffer);
+		}
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(display, context);
+	}
+	if (display != EGL_NO_DISPLAY)
+		eglTerminate(display);
+		
+	display = EGL_NO_DISPLAY;
+	context = EGL_NO_CONTEXT;
+	framebuffer = 0;
+	renderbuffers[0] = renderbuffers[1] = 0;
+	width = height = 0;
+}
+
+bool OffscreenContext::hasAccumBuffer() const
+{
+	GLint accumBits = 0;
+	glGetIntegerv(GL_ACCUM_RED_BITS, &accumBits);
+	return accumBits > 0;
+}
+
+void OffscreenContext::readPixels(std::vector<unsigned char> &pixels) const
+{
+	pixels.resize(width * height * 3);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+}
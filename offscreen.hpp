@@ -0,0 +1,40 @@
+#ifndef OFFSCREEN_HPP
+#define OFFSCREEN_HPP
+
+#include <EGL/egl.h>
+#include <GL/gl.h>
+#include <vector>
+
+// A desktop OpenGL context with no window, rendering into a framebuffer
+// object with the colour, depth and stencil bits the renderer expects of its
+// window. Destroying the context frees every GL object created in it.
+class OffscreenContext
+{
+	public:
+		OffscreenContext();
+		~OffscreenContext();
+		
+		// Make a width x height context current. Prints why and returns
+		// false if it can't.
+		bool create(int width, int height);
+		void destroy();
+		
+		// Framebuffer objects never have an accumulation buffer, but a
+		// driver may still hand us a default framebuffer that does
+		bool hasAccumBuffer() const;
+		
+		// Tightly packed RGB, bottom row first as GL returns it
+		void readPixels(std::vector<unsigned char> &pixels) const;
+		
+		int getWidth() const { return width; }
+		int getHeight() const { return height; }
+		
+	private:
+		EGLDisplay display;
+		EGLContext context;
+		GLuint framebuffer;
+		GLuint renderbuffers[2];
+		int width, height;
+};
+
+#endif
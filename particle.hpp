@@ -1,7 +1,6 @@
 #ifndef PARTICLE_HPP
 #define PARTICLE_HPP
 
-#include <gtkmm.h>
 #include "algebra.hpp"
 
 class Particle 
@@ -0,0 +1,2254 @@
+#include "renderer.hpp"
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <GL/gl.h>
+#include <GL/glut.h>
+#include <assert.h>
+#include <math.h>
+#include <sys/time.h>
+#include "shader.hpp"
+
+#define NUM_SPHERE_LODS 3
+#define LIGHT_SPHERE_RADIUS 1.3f
+
+// Vertical field of view in degrees, and where the projection puts the
+// camera
+#define FIELD_OF_VIEW 40.0
+#define CAMERA_X -3.0
+#define CAMERA_Y 5.0
+#define CAMERA_Z -30.0
+using namespace std;
+
+// Normal mapping for the board cubes. The vertex shader builds a tangent
+// frame from the (axis aligned) face normal and moves the vector to the
+// light into it, so the fragment shader only has to sample the bump map
+// and the skin.
+static const char *BUMP_VERTEX_SHADER =
+	"uniform vec3 lightEye;\n"
+	"varying vec3 toLight;\n"
+	"void main()\n"
+	"{\n"
+	"	vec3 n = gl_Normal;\n"
+	"	vec3 t = abs(n.y) > 0.5 ? vec3(1.0, 0.0, 0.0) : cross(vec3(0.0, 1.0, 0.0), n);\n"
+	"	vec3 b = cross(n, t);\n"
+	"	vec3 l = lightEye - vec3(gl_ModelViewMatrix * gl_Vertex);\n"
+	"	n = gl_NormalMatrix * n;\n"
+	"	t = gl_NormalMatrix * t;\n"
+	"	b = gl_NormalMatrix * b;\n"
+	"	toLight = vec3(dot(l, t), dot(l, b), dot(l, n));\n"
+	"	gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+	"	gl_Position = ftransform();\n"
+	"}\n";
+
+static const char *BUMP_FRAGMENT_SHADER =
+	"uniform sampler2D skin;\n"
+	"uniform sampler2D bumpMap;\n"
+	"varying vec3 toLight;\n"
+	"void main()\n"
+	"{\n"
+	"	vec3 n = texture2D(bumpMap, gl_TexCoord[0].st).rgb * 2.0 - 1.0;\n"
+	"	float diffuse = max(dot(normalize(toLight), normalize(n)), 0.0);\n"
+	"	vec4 colour = texture2D(skin, gl_TexCoord[0].st);\n"
+	"	gl_FragColor = vec4(colour.rgb * diffuse, colour.a);\n"
+	"}\n";
+
+// Unit cube faces with correct normals, front face first
+static const float CUBE_NORMALS[6][3] = {
+	{ 0, 0, 1 }, { 0, 0, -1 }, { 0, 1, 0 }, { 0, -1, 0 }, { 1, 0, 0 }, { -1, 0, 0 }
+};
+static const float CUBE_FACES[6][4][3] = {
+	{ { 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 } },
+	{ { 1, 0, 0 }, { 0, 0, 0 }, { 0, 1, 0 }, { 1, 1, 0 } },
+	{ { 0, 1, 1 }, { 1, 1, 1 }, { 1, 1, 0 }, { 0, 1, 0 } },
+	{ { 0, 0, 0 }, { 1, 0, 0 }, { 1, 0, 1 }, { 0, 0, 1 } },
+	{ { 1, 0, 1 }, { 1, 0, 0 }, { 1, 1, 0 }, { 1, 1, 1 } },
+	{ { 0, 0, 0 }, { 0, 0, 1 }, { 0, 1, 1 }, { 0, 1, 0 } }
+};
+static const float FACE_TEX_COORDS[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+
+static void drawCubeFaces(int numFaces)
+{
+	glBegin(GL_QUADS);
+	for (int f = 0;f<numFaces;f++)
+	{
+		glNormal3fv(CUBE_NORMALS[f]);
+		for (int v = 0;v<4;v++)
+		{
+			glTexCoord2fv(FACE_TEX_COORDS[v]);
+			glVertex3fv(CUBE_FACES[f][v]);
+		}
+	}
+	glEnd();
+}
+
+// Wall clock time in seconds
+static double currentTime()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+Renderer::Renderer()
+{
+	// Set all rotationAngles to 0
+	rotationAngleX = 0;
+	rotationAngleY = 0;
+	rotationAngleZ = 0;
+	rotationSpeed = 0;
+	spinX = false;
+	spinY = false;
+	spinZ = false;
+	
+	// Default draw mode is multicoloured
+	currentDrawMode = Renderer::FACE;
+
+	// Default scale factor is 1
+	scaleFactor = 1;
+	
+	startScreen = true;
+	singleSkinMode = false;
+	activeTextureId = 0;
+	loadTexture = true;
+	loadBumpMapping = false;
+	transluceny = false;
+	motionBlur = false;
+	levelUpAnimation = false;
+	drawShadow = false;
+	numTextures = 0;
+	staticGeometryBuffer = 0;
+	viewHeight = 0;
+	showProfile = false;
+	profileFrames = 0;
+	profileFrameTime = 0;
+	profileStart = currentTime();
+	snapshot = NULL;
+	
+	// The mascot's moods are parsed up front so changing them during play
+	// never touches the disk
+	neutralAnimation = animations.load("head");
+	happyAnimation = animations.load("headHappy");
+	sadAnimation = animations.load("headSad");
+	setAnimation(neutralAnimation);
+	
+	lightPos[0] = 4.6f;
+	lightPos[1] = 6.79998f;
+	lightPos[2] = 62.6f;
+	lightPos[3] = 1.0f;
+}
+
+void Renderer::initGL()
+{
+	texture = new GLuint[7];
+	LoadGLTextures("playButton.bmp", playButtonTex);
+	LoadGLTextures("playButtonClicked.bmp", playButtonClickedTex);
+	LoadGLTextures("soundOn.bmp", soundOnTex);
+	LoadGLTextures("soundOff.bmp", soundOffTex);
+	LoadGLTextures("singleSkinMode.bmp", singleSkinModeTex);
+	LoadGLTextures("singleSkinModeClicked.bmp", singleSkinModeClickedTex);
+	// Load the block skins for every level up front so that levelling up
+	// only has to swap texture ids instead of creating new textures
+	for (int level = 1;level<=NUM_TEXTURES;level++)
+	{
+		std::stringstream levelStream;
+		levelStream << level;
+		LoadGLTextures(("x" + levelStream.str() + ".bmp").c_str(), levelTextures[level-1][0]);
+		LoadGLTextures(("o" + levelStream.str() + ".bmp").c_str(), levelTextures[level-1][1]);
+		LoadGLTextures(("xLight" + levelStream.str() + ".bmp").c_str(), levelTextures[level-1][2]);
+		LoadGLTextures(("oLight" + levelStream.str() + ".bmp").c_str(), levelTextures[level-1][3]);
+	}
+	setLevelTextures(1);
+	LoadGLTextures("black.bmp", texture[4]);
+	LoadGLTextures("normal.bmp", bumpMap);
+	LoadGLTextures("floor.bmp", floorTexId);
+
+	LoadGLTextures("background.bmp", backgroundTex);
+	
+	// The normalization cube map is only needed by the combiner bump mapping
+	// path, so it is built the first time that path is drawn
+	cube = 0;
+	
+	// The floor and background tile, set this once on the texture objects
+	glState.bindTexture(GL_TEXTURE_2D, floorTexId);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
+	glState.bindTexture(GL_TEXTURE_2D, backgroundTex);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
+	glState.bindTexture(GL_TEXTURE_2D, 0);
+	
+	
+	// Sphere for particles
+	GLUquadricObj *sphere = gluNewQuadric();
+	gluQuadricNormals(sphere, GLU_SMOOTH);	// Generate Smooth Normals For The Quad
+	gluQuadricTexture(sphere, GL_TRUE);		// Enable Texture Coords For The Quad
+	sphereDisplayList = glGenLists(4);
+	glNewList(sphereDisplayList, GL_COMPILE);
+		gluSphere(sphere, 1.0f, 32, 32);
+	glEndList();
+	
+	// Spheres for the light source marker, from finest to coarsest
+	lightSphereDisplayList = glGenLists(NUM_SPHERE_LODS);
+	for (int i = 0;i<NUM_SPHERE_LODS;i++)
+	{
+		int slices = 32 >> i;
+		glNewList(lightSphereDisplayList + i, GL_COMPILE);
+			gluSphere(sphere, LIGHT_SPHERE_RADIUS, slices, slices);
+		glEndList();
+	}
+	gluDeleteQuadric(sphere);
+	
+	// Cubes for the game board
+	texCubeDisplayList = sphereDisplayList + 1;
+	glNewList(texCubeDisplayList, GL_COMPILE);
+		glBegin(GL_QUADS);
+		 	glTexCoord2f(0.0f, 0.0f);
+			glVertex3d(0, 0, 1);
+
+			glTexCoord2f(1.0f, 0.0f);
+			glVertex3d(1, 0, 1);
+
+			glTexCoord2f(1.0f, 1.0f);
+			glVertex3d(1, 1, 1);
+
+			glTexCoord2f(0.0f, 1.0f);	
+			glVertex3d(0, 1, 1);
+		glEnd();
+		// top face
+		glNormal3d(0, 1, 0);
+
+		glBegin(GL_QUADS);
+		 	glTexCoord2f(0.0f, 0.0f);
+			glVertex3d(0, 1, 0);
+			glTexCoord2f(1.0f, 0.0f);
+			glVertex3d(1, 1, 0);
+			glTexCoord2f(1.0f, 1.0f);
+			glVertex3d(1, 1, 1);
+			glTexCoord2f(0.0f, 1.0f);
+			glVertex3d(0, 1, 1);
+		glEnd();
+
+		// left face
+		glNormal3d(0, 0, -1);
+
+		glBegin(GL_QUADS);
+			glTexCoord2f(0.0f, 0.0f);
+			glVertex3d(0, 0, 0);
+			glTexCoord2f(1.0f, 0.0f);
+			glVertex3d(0, 1, 0);
+			glTexCoord2f(1.0f, 1.0f);
+			glVertex3d(0, 1, 1);
+			glTexCoord2f(0.0f, 1.0f);
+			glVertex3d(0, 0, 1);
+		glEnd();
+
+		// bottom face
+		glNormal3d(0, -1, 0);
+
+		glBegin(GL_QUADS);
+			glTexCoord2f(0.0f, 0.0f);
+			glVertex3d(0, 0, 0);
+			glTexCoord2f(1.0f, 0.0f);
+			glVertex3d(1, 0, 0);
+			glTexCoord2f(1.0f, 1.0f);
+			glVertex3d(1, 0, 1);
+			glTexCoord2f(0.0f, 1.0f);
+			glVertex3d(0, 0, 1);
+		glEnd();
+
+		// right face
+		glNormal3d(0, 0, 1);
+
+		glBegin(GL_QUADS);
+			glTexCoord2f(0.0f, 0.0f);
+			glVertex3d(1, 0, 0);
+			glTexCoord2f(1.0f, 0.0f);
+			glVertex3d(1, 1, 0);
+			glTexCoord2f(1.0f, 1.0f);
+			glVertex3d(1, 1, 1);
+			glTexCoord2f(0.0f, 1.0f);
+			glVertex3d(1, 0, 1);
+		glEnd();
+
+		// Back of front face
+		glNormal3d(-1, 0, 0);
+
+		glBegin(GL_QUADS);
+			glTexCoord2f(0.0f, 0.0f);
+			glVertex3d(0, 0, 0);
+			glTexCoord2f(1.0f, 0.0f);
+			glVertex3d(1, 0, 0);
+			glTexCoord2f(1.0f, 1.0f);	
+			glVertex3d(1, 1, 0);
+			glTexCoord2f(0.0f, 1.0f);
+			glVertex3d(0, 1, 0);
+		glEnd();
+	glEndList();
+	
+	// Create display list for outline
+	outlineDisplayList = texCubeDisplayList + 1;
+	glNewList(outlineDisplayList, GL_COMPILE);
+		glLineWidth (1.2);
+		glBegin(GL_LINE_LOOP);
+			glVertex3d(0, 0, 1);
+
+			glVertex3d(1, 0, 1);
+
+			glVertex3d(1, 1, 1);
+
+			glVertex3d(0, 1, 1);
+		glEnd();
+		// top face
+		glNormal3d(0, 1, 0);
+
+		glBegin(GL_LINE_LOOP);
+			glVertex3d(0, 1, 0);
+			glVertex3d(1, 1, 0);
+			glVertex3d(1, 1, 1);
+			glVertex3d(0, 1, 1);
+		glEnd();
+
+		// left face
+		glNormal3d(0, 0, -1);
+
+		glBegin(GL_LINE_LOOP);
+			glVertex3d(0, 0, 0);
+			glVertex3d(0, 1, 0);
+			glVertex3d(0, 1, 1);
+			glVertex3d(0, 0, 1);
+		glEnd();
+
+		// bottom face
+		glNormal3d(0, -1, 0);
+
+		glBegin(GL_LINE_LOOP);
+			glVertex3d(0, 0, 0);
+			glVertex3d(1, 0, 0);
+			glVertex3d(1, 0, 1);
+			glVertex3d(0, 0, 1);
+		glEnd();
+
+		// right face
+		glNormal3d(0, 0, 1);
+
+		glBegin(GL_LINE_LOOP);
+			glVertex3d(1, 0, 0);
+			glVertex3d(1, 1, 0);
+			glVertex3d(1, 1, 1);
+			glVertex3d(1, 0, 1);
+		glEnd();
+
+		// Back of front face
+		glNormal3d(-1, 0, 0);
+
+		glBegin(GL_LINE_LOOP);
+			glVertex3d(0, 0, 0);
+			glVertex3d(1, 0, 0);
+			glVertex3d(1, 1, 0);
+			glVertex3d(0, 1, 0);
+		glEnd();
+	glEndList();
+	
+	// Reflection display list
+	reflectCubeDisplayList = outlineDisplayList + 1;
+	glNewList(reflectCubeDisplayList, GL_COMPILE);
+		glBegin(GL_QUADS);
+		 	glTexCoord2f(0.0f, 0.0f);
+			glVertex3d(0, 0, 1);
+
+			glTexCoord2f(1.0f, 0.0f);
+			glVertex3d(1, 0, 1);
+
+			glTexCoord2f(1.0f, 1.0f);
+			glVertex3d(1, 1, 1);
+
+			glTexCoord2f(0.0f, 1.0f);	
+			glVertex3d(0, 1, 1);
+		glEnd();
+	glEndList();
+		
+	// Normal mapped cubes. The reflection only needs the front face.
+	bumpCubeDisplayList = glGenLists(2);
+	glNewList(bumpCubeDisplayList, GL_COMPILE);
+		drawCubeFaces(6);
+	glEndList();
+	glNewList(bumpCubeDisplayList + 1, GL_COMPILE);
+		drawCubeFaces(1);
+	glEndList();
+	
+	// Fall back to the multitexture combiners if GLSL isn't available
+	bumpProgram = 0;
+	if (shadersSupported())
+		bumpProgram = buildProgram(BUMP_VERTEX_SHADER, BUMP_FRAGMENT_SHADER);
+	if (bumpProgram)
+	{
+		glUseProgram(bumpProgram);
+		glUniform1i(glGetUniformLocation(bumpProgram, "skin"), 0);
+		glUniform1i(glGetUniformLocation(bumpProgram, "bumpMap"), 1);
+		bumpLightUniform = glGetUniformLocation(bumpProgram, "lightEye");
+		glUseProgram(0);
+	}
+	
+	// Static scene geometry
+	glGenBuffers(1, &staticGeometryBuffer);
+	bakeStaticGeometry(WELL_WIDTH, WELL_HEIGHT);
+	
+	// Load default aniamtion
+	setAnimation(neutralAnimation);
+		
+	
+	glClearDepth (1.0f);								
+	glDepthFunc (GL_LEQUAL);							
+	glState.enable(GL_DEPTH_TEST);
+	glShadeModel (GL_SMOOTH);							
+	glHint (GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);	
+	
+	
+
+/*	// Basic line anti aliasing
+	// Blendfunc is set wrong though. Need to figure out what is good
+	glEnable (GL_LINE_SMOOTH);
+	glEnable (GL_BLEND);
+	glBlendFunc (GL_SRC_COLOR, GL_DST_COLOR);
+	glHint (GL_LINE_SMOOTH_HINT, GL_NICEST);
+*/
+	glClearColor(1.0, 1.0, 1.0, 1.0);
+	
+	// Initialize random number generator
+ 	srand ( time(NULL) );
+	
+	// Texture loading and display list compilation above talk to GL
+	// directly, so start the state cache from scratch
+	glState.invalidate();
+}
+
+void Renderer::renderFrame()
+{
+	// Clear the screen
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+	beginStaticGeometry();
+
+	// Modify the current projection matrix so that we move the 
+	// camera away from the origin.  We'll draw the game at the
+	// origin, and we need to back up to see it.
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glTranslated(CAMERA_X, CAMERA_Y, CAMERA_Z);
+
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+	
+	// set up lighting (if necessary)
+	// Followed the tutorial found http://www.falloutsoftware.com/tutorials/gl/gl8.htm
+	// to implement lighting
+	
+	// Initialize lighting settings
+	glShadeModel(GL_SMOOTH);
+	glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
+	
+	// Scale and rotate the scene
+	
+	if (scaleFactor != 1)
+		glScaled(scaleFactor, scaleFactor, scaleFactor);
+		
+	if (rotationAngleX != 0)
+		glRotated(rotationAngleX, 1, 0, 0);
+	
+	if (rotationAngleY != 0)
+		glRotated(rotationAngleY, 0, 1, 0);
+
+	if (rotationAngleZ != 0)
+		glTranslatef(rotationAngleZ, 0, 0);
+	
+	// The light marker's detail, for the view as it is this frame
+	int lightLod = lightSphereLod();
+	
+	// Increment rotation angles for next render
+	if (spinX)
+	{
+		rotationAngleX += rotationSpeed;
+		if (rotationAngleX > 360)
+			rotationAngleX -= 360;
+	}
+	if (spinY)
+	{
+		rotationAngleY += rotationSpeed;
+		if (rotationAngleY > 360)
+			rotationAngleY -= 360;
+	}
+	if (spinZ)
+	{
+		rotationAngleZ += rotationSpeed;
+		if (rotationAngleZ > 360)
+			rotationAngleZ -= 360;
+	}
+	
+	// You'll be drawing unit cubes, so the game will have width
+	// 10 and height 24 (game = 20, stripe = 4).  Let's translate
+	// the game so that we can draw it starting at (0,0) but have
+	// it appear centered in the window.
+	glTranslated(-7.5, -10.0, 7.0);
+	
+	if (startScreen)
+	{
+		drawBackground();
+		drawFloor();
+		drawStartScreen(false);
+		
+		// We pushed a matrix onto the PROJECTION stack earlier, we 
+		// need to pop it.
+
+		glMatrixMode(GL_PROJECTION);
+		glPopMatrix();
+		glMatrixMode(GL_MODELVIEW);
+		return;
+	}
+	
+	// Create one light source
+	glState.enable(GL_LIGHTING);
+	glState.enable(GL_LIGHT0);
+	glState.enable(GL_COLOR_MATERIAL);
+	//glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
+	// Define properties of light 
+	float ambientLight0[] = { 0.1f, 0.1f, 0.1f, 1.0f };
+	float diffuseLight0[] = { 0.8f, 0.8f, 0.8f, 1.0f };
+	float specularLight0[] = { 0.6f, 0.6f, 0.6f, 1.0f };
+
+	glLightfv(GL_LIGHT0, GL_AMBIENT, ambientLight0);
+	glLightfv(GL_LIGHT0, GL_DIFFUSE, diffuseLight0);
+	glLightfv(GL_LIGHT0, GL_SPECULAR, specularLight0);
+	glLightfv(GL_LIGHT0, GL_POSITION, lightPos);
+
+	
+	if (!motionBlur)
+	{	
+		drawScene();
+	}
+	else
+	{
+		if (snapshot->counter == 0)
+		{
+			glClear(GL_ACCUM_BUFFER_BIT);
+			drawFallingBox();
+			glAccum(GL_RETURN, 1.f);
+		}
+		else
+		{
+			drawScene();
+		}
+	}
+
+	// Light source marker
+	useTexture(0);
+	glColor3f(1.f, 1.f, 0.f);
+	glPushMatrix();
+		glTranslatef(lightPos[0], lightPos[1], lightPos[2]);
+		glCallList(lightSphereDisplayList + lightLod);
+	glPopMatrix();
+	
+ 	// We pushed a matrix onto the PROJECTION stack earlier, we 
+	// need to pop it.
+
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+}
+
+void Renderer::drawScene()
+{
+	if (drawShadow)
+	{
+		glState.disable(GL_DEPTH_TEST);
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+		glState.enable(GL_STENCIL_TEST);
+		glStencilOp(GL_REPLACE, GL_REPLACE, GL_REPLACE);
+		glStencilFunc(GL_ALWAYS, 1, 0xffffffff);
+
+		drawFloor();
+
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glState.enable(GL_DEPTH_TEST);
+
+		glStencilFunc(GL_EQUAL, 1, 0xffffffff);
+		glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+
+		drawShadowVolumes();
+		silhouette.clear();
+		drawFloor();	
+
+		glState.disable(GL_STENCIL_TEST);	
+	}
+	
+	drawBackground();
+	drawFloor();
+	drawReflections();	
+	drawGameboard();
+	drawGrid();
+	drawParticles();	
+	drawBar();
+	glState.disable(GL_LIGHTING);
+	drawAnimatables();
+	glState.enable(GL_LIGHTING);
+	
+	if (levelUpAnimation)
+	{	
+		levelUpAnimation = false;
+		addFireworks(8 + rand()%4 - 2, 5 + rand()%4 - 2);
+		addFireworks(3 + rand()%4 - 2, 3 + rand()%4 - 2);
+		addFireworks(3 + rand()%4 - 2, 8 + rand()%4 - 2);
+		addFireworks(8 + rand()%4 - 2, 2 + rand()%4 - 2);
+		addFireworks(14 + rand()%4 - 2, 6 + rand()%4 - 2);
+		addFireworks(16 + rand()%4 - 2, 8 + rand()%4 - 2);
+	}
+}
+
+void Renderer::drawAnimatables()
+{
+	useTexture(0);
+	glPushMatrix();
+		glTranslatef(16, 3, 0);
+		glScalef(0.5, 0.5, 0.5);
+		Point3D frame;
+		float scale[3];
+		float rotate[3];
+		const AnimationClip &animation = animations.get(currentAnimation);
+		for (unsigned int i = 0;i<animation.tracks.size();i++)
+		{
+			const KeyframeTrack &track = animation.tracks[i];
+			track.sample(animationTime, frame, scale, rotate);
+			glPushMatrix();			
+				glColor3f(track.colour[0], track.colour[1], track.colour[2]);
+				glRotatef(rotate[0], 1, 0, 0);
+				glRotatef(rotate[1], 0, 1, 0);
+				glRotatef(rotate[2], 0, 0, 1);
+				glTranslatef(frame[0], frame[1], frame[2]);
+				glScalef(scale[0], scale[1], scale[2]);
+			
+				// Draw something
+				if (track.shapeType == 1)
+				{
+					glCallList(sphereDisplayList);
+				}
+				else
+				{
+					glBegin(GL_QUADS);
+						glVertex3f(0, 0, 0);
+						glVertex3f(1, 0, 0);
+						glVertex3f(1, 1, 0);
+						glVertex3f(0, 1, 0);
+					glEnd();
+				}
+			glPopMatrix();
+		}
+		
+		// One frame per redraw. Once a mood has played out go back to the
+		// neutral face.
+		animationTime += 1;
+		if (animation.finished(animationTime))
+			setAnimation(neutralAnimation);
+	glPopMatrix();
+}
+void Renderer::drawBackground()
+{
+	useTexture(backgroundTex);
+	drawStaticGeometry(backgroundRange);
+}
+/*
+void Renderer::drawMoveBlur(int side)
+{
+	int r = game->py_;
+	int c = game->px_;
+	std::cout << r << ", " << c << std::endl;
+	
+		std::cout << game->get(r-1, c) << "\n";
+		std::cout << game->get(r-side, c+side) << "\n";
+		std::cout << game->get(r-side, c-side) << "\n";
+			
+//	c = c - side;
+		
+	glEnable(GL_BLEND);
+	
+	for (int i = 0;i<10;i++)
+	{
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		drawCube(r-side, c + side * (i * 0.1), game->get(r-side, c+side), GL_QUADS);
+		drawCube(r-side-1, c + side * (i * 0.1), game->get(r-side, c+side), GL_QUADS);
+	}
+	glDisable(GL_BLEND);
+}
+*/
+void Renderer::drawReflections()
+{
+	/* Don't update color or depth. */
+	drawFloor();
+
+	  /* Draw reflected ninja, but only where floor is. */
+	glPushMatrix();
+		glRotatef(90, 1.0, 0, 0);
+		glTranslatef(0, 1, -1.01);
+		glState.enable(GL_BLEND);
+			glState.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+				glColor4f(0.7, 0.0, 0.0, 0.40);  /* 40% dark red floor color */
+				drawGameboard(false);
+				drawParticles(false);
+		glState.disable(GL_BLEND);
+	glPopMatrix();
+}
+void Renderer::drawGrid()
+{
+	useTexture(0);
+	glColor3d(1, 0, 0);
+	glLineWidth(1.2);
+	drawStaticGeometry(gridLinesRange);
+	drawStaticGeometry(gridDotsRange);
+	
+	glLineWidth(1.5);
+	drawStaticGeometry(gridBorderRange);
+}
+void Renderer::drawParticles(bool step)
+{
+	glState.enable(GL_BLEND);
+	float mag;
+	Point3D pos;
+	float rad;
+	float *colour;
+	Vector3D velocity;
+	Point3D col;
+	float alpha;
+	glState.blendFunc(GL_SRC_ALPHA,  GL_ONE_MINUS_SRC_ALPHA);
+	for (unsigned int i = 0;i<particles.size();i++)
+	{
+		pos = particles[i]->getPos();
+		rad = particles[i]->getRadius();
+		alpha = particles[i]->getAlpha();
+		
+		if (particles[i]->getShape() == 0)
+		{			
+			mag = pos[0] * pos[0] + pos[1] * pos[1] + pos[2] * pos[2];
+			mag = (1.f/mag);
+			glColor4f(mag * pos[0], mag * pos[1], mag * pos[2], alpha);
+			glPushMatrix();
+				glTranslatef(pos[0], pos[1], pos[2]);
+				useTexture(texture[particles[i]->getColourIndex() - 1]);
+				glScalef(rad, rad, 1);
+				glCallList(reflectCubeDisplayList);
+/*				glBegin(GL_QUADS);
+					glTexCoord2f(0.0f, 0.0f);
+					glVertex3d(0, 0, 1);
+					glTexCoord2f(1.0f, 0.0f);
+					glVertex3d(rad, 0, 1);
+					glTexCoord2f(1.0f, 1.0f);
+					glVertex3d(rad, rad, 1);
+					glTexCoord2f(0.0f, 1.0f);
+					glVertex3d(0, rad, 1);
+				glEnd();*/
+			glPopMatrix();
+		}	
+		else if (particles[i]->getShape() == 1 && step)
+		{
+			colour = particles[i]->getColour();
+			useTexture(0);
+			glColor4f(colour[0], colour[1], colour[2], alpha);
+			glPushMatrix();
+				glTranslatef(pos[0], pos[1], pos[2]);
+				glScalef(rad, rad, rad);
+				glCallList(sphereDisplayList);
+			glPopMatrix();	
+
+			if (colour[1] > 1)
+			{
+				colour[1] = 1;
+				colour[0] = 0;
+			}
+			
+			if (colour[2] > 1)
+				colour[2] = 1;
+				
+			if (colour[0] > 0)
+			{
+				colour[1] += 0.2;
+			}
+			else
+				colour[2] += 0.2;
+		}
+		
+		if (step && particles[i]->step(0.1))
+		{
+			particles.erase(particles.begin() + i);
+		}
+	}
+	glState.disable(GL_BLEND);
+}
+void Renderer::addParticleBox(float x, float y, int colour)
+{
+	Point3D pos(x, y, 0);
+	float radius = 0.2f;
+	float decay = 2.f;
+	float n = 10.f;
+	float empty[3];
+	empty[0] = 0;
+	empty[1] = 0;
+	empty[2] = 0;
+	for (int i = 0;i<n;i++)
+	{
+		for (int j = 0;j<n;j++)
+		{
+			Vector3D randVel(rand()%5 - 2.5f, rand()%5 - 2.5f, 0);
+			Vector3D randAccel(rand()%5 - 2.5f, rand()%5 - 2.5f, 0);
+			Particle *p = new Particle(pos, radius, randVel, decay, empty, randAccel, 0);
+			p->setColourIndex(colour);
+			particles.push_back(p);			
+			pos[0] = x + (j / n);
+		}
+		pos[1] = pos[1] + 1.f/n;
+	}
+}
+
+void Renderer::addFireworks(float x, float y)
+{
+	Point3D pos(x, y, 0);
+	float radius = 0.2f;
+	float decay = 2.5f;
+	float n = 10.f;
+	for (int i = 0;i<n;i++)
+	{
+		for (int j = 0;j<n;j++)
+		{
+			float *colour = (float *)malloc(sizeof(float) * 3);
+			colour[0] = rand()%1000 + 1000;
+			colour[1] = rand()%1000 + 1000;
+			colour[2] = rand()%1000 + 1000;
+			colour[0] /= 1000.f;
+			colour[1] /= 1000.f;
+			colour[2] /= 1000.f;
+			
+			colour[0] = 1;
+			colour[1] = 0;
+			colour[2] = 0;
+			float a = rand()%10000 + 1000;
+			float b = rand()%10000 + 1000;
+			a /= 1000.f;
+			b /= 1000.f;
+			Vector3D randVel(a - 5.f, b - 5.f, 0);
+			Vector3D randAccel(0, -9.8f + rand() % 5, 0);
+			particles.push_back(new Particle(pos, radius, randVel, decay, colour, randAccel, 1));			
+			//pos[0] = x + (j / n);
+		}
+	//	pos[1] = pos[1] + 1.f/n;
+	}
+}
+
+void Renderer::drawRoom()							// Draw The Room (Box)
+{
+	glColor3d(0, 1, 0);
+	drawStaticGeometry(roomRange);
+}
+
+
+void Renderer::drawShadowVolumes()
+{
+	useTexture(0);
+	for (int i = WELL_HEIGHT+3;i>=0;i--) // row
+	{
+		for (int j = WELL_WIDTH - 1; j>=0;j--) // column
+		{				
+			float y;
+			if (cellColour(i, j, y) != -1)
+			{
+				drawShadowCube (y, j, GL_QUADS );
+				
+			}
+		}
+	}
+	
+	
+	Vector3D temp, temp2;
+	Point3D temp3;
+	Point3D lightPoint(lightPos[0], lightPos[1], lightPos[2]);
+	glColor4d(0, 0, 0, 0.3);
+	
+	for (unsigned int i = 0;i<silhouette.size();i++)
+	{
+		
+		temp =  silhouette[i].first - lightPoint;
+		temp2 = silhouette[i].second - lightPoint;
+		temp3 = silhouette[i].first +  100*temp;
+			
+			glBegin(GL_QUADS);			
+			glVertex3d(silhouette[i].first[0], silhouette[i].first[1], silhouette[i].second[2]);
+			glVertex3d(temp3[0], temp3[1], temp3[2]);
+			temp3 = silhouette[i].second + 100*temp2;	
+			glVertex3d(temp3[0], temp3[1], temp3[2]);
+			glVertex3d(silhouette[i].second[0], silhouette[i].second[1], silhouette[i].second[2]);
+			glEnd();
+	}
+	glColor4d(1, 1, 1, 1);
+}
+
+void Renderer::drawShadowCube(float y, float x, GLenum mode)
+{
+	Point3D a, b, c, d, e, f, g, h, temp3;
+	Point3D lightPoint(lightPos[0], lightPos[1], lightPos[2]);
+	Vector3D temp, temp2;
+	Vector3D lightVec = lightPoint - Point3D(0, 0, 0);
+	a = Point3D(x, y, 1);
+	b = Point3D(1 + x, y, 1);
+	c = Point3D(1 + x, 1 + y, 1);
+	d = Point3D(x, 1 + y, 1);
+	e = a;
+	f = b;
+	g = c;
+	h = d;
+	
+	e[2] = 0;
+	f[2] = 0;
+	g[2] = 0;
+	h[2] = 0;
+	
+	if (Vector3D(0, 0, 1).dot(lightVec) > 0)
+	{
+		silhouette.push_back(std::pair<Point3D, Point3D>(a, b ));
+		silhouette.push_back(std::pair<Point3D, Point3D>(c, b ));
+		silhouette.push_back(std::pair<Point3D, Point3D>(c, d ));
+		silhouette.push_back(std::pair<Point3D, Point3D>(d, a));		
+	}
+	
+	if (Vector3D(0, 1, 0).dot(lightVec) > 0)
+	{
+		silhouette.push_back(std::pair<Point3D, Point3D>(c, d) );
+		silhouette.push_back(std::pair<Point3D, Point3D>(c, g) );
+		silhouette.push_back(std::pair<Point3D, Point3D>(g, h) );
+		silhouette.push_back(std::pair<Point3D, Point3D>(h, d) );		
+	}
+	
+
+	
+	if (Vector3D(1, 0, 0).dot(lightVec) > 0)
+	{
+		silhouette.push_back(std::pair<Point3D, Point3D>(b, f) );
+		silhouette.push_back(std::pair<Point3D, Point3D>(c, g) );
+		silhouette.push_back(std::pair<Point3D, Point3D>(b, c) );
+		silhouette.push_back(std::pair<Point3D, Point3D>(g, f) );		
+	}
+	
+	if (Vector3D(-1, 0, 0).dot(lightVec) > 0)
+	{
+		silhouette.push_back(std::pair<Point3D, Point3D>(a, e) );
+		silhouette.push_back(std::pair<Point3D, Point3D>(d, h) );
+		silhouette.push_back(std::pair<Point3D, Point3D>(a, d) );
+		silhouette.push_back(std::pair<Point3D, Point3D>(h, e) );
+		std::cerr << "left face " << Vector3D(-1, 0, 0).dot(lightVec) << "\n";		
+	}
+	
+	if (Vector3D(0, -1, 0).dot(lightVec) > 0)
+	{
+		silhouette.push_back(std::pair<Point3D, Point3D>(b, a) );
+		silhouette.push_back(std::pair<Point3D, Point3D>(b, f) );
+		silhouette.push_back(std::pair<Point3D, Point3D>(f, e) );
+		silhouette.push_back(std::pair<Point3D, Point3D>(e, a) );		
+		std::cerr << "bottom face " << Vector3D(0, -1, 0).dot(lightVec) << "\n";
+	}
+
+	if (Vector3D(0, 0, -1).dot(lightVec) > 0)
+	{
+		silhouette.push_back(std::pair<Point3D, Point3D>(e, f) );
+		silhouette.push_back(std::pair<Point3D, Point3D>(g, f) );
+		silhouette.push_back(std::pair<Point3D, Point3D>(g, h) );
+		silhouette.push_back(std::pair<Point3D, Point3D>(h, e) );
+		std::cerr << "back face " << Vector3D(0, 0, -1).dot(lightVec) << "\n";		
+	}
+	for (unsigned int i = 0;i<silhouette.size();i++)
+	{
+		for (unsigned int j = i+1;j<silhouette.size();j++)
+		{
+			if (silhouette[i].first == silhouette[j].first && silhouette[i].second == silhouette[j].second)	
+			{
+			//	std::cerr << silhouette[i].first << "\t" << silhouette[j].first << "\t" << silhouette[i].second << "\t" << silhouette[j].second << std::endl;
+				silhouette.erase (silhouette.begin() + i);
+				silhouette.erase (silhouette.begin() + j-1);
+				break;
+			}
+			else if (silhouette[i].first == silhouette[j].second && silhouette[i].second == silhouette[j].first)	
+			{
+			//	std::cerr << silhouette[i].first << "\t" << silhouette[j].second << "\t" << silhouette[i].second << "\t" << silhouette[j].first << std::endl;
+				silhouette.erase (silhouette.begin() + i);
+				silhouette.erase (silhouette.begin() + j-1);
+				break; 
+			}
+		}
+	}
+	
+}
+
+
+void Renderer::drawBar()
+{
+	// Clear bar. The bar geometry is baked at x = 0, so the only thing
+	// that changes from frame to frame is the translation.
+	useTexture(0);
+	glPushMatrix();
+		glTranslated(snapshot->clearBarPos, 0, 0);
+		drawStaticGeometry(barRange);
+	glPopMatrix();
+}
+
+void Renderer::drawFallingBox()
+{	
+	int iter = 4;
+	float iterFrac = 1.f/iter;
+	for (int i = 0;i<iter;i++)
+	{
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			drawScene();
+		
+		
+		glPushMatrix();
+	    	glTranslatef(0, i * iterFrac, 0);
+			drawCube (snapshot->py - 1, snapshot->px + 1, snapshot->getPieceCell(snapshot->py - 1, snapshot->px + 1), GL_QUADS );
+			drawCube (snapshot->py - 1, snapshot->px + 2, snapshot->getPieceCell(snapshot->py - 1, snapshot->px + 2), GL_QUADS );
+			drawCube (snapshot->py - 2, snapshot->px + 1, snapshot->getPieceCell(snapshot->py - 1, snapshot->px + 1), GL_QUADS );
+			drawCube (snapshot->py - 2, snapshot->px + 2, snapshot->getPieceCell(snapshot->py - 1, snapshot->px + 2), GL_QUADS );
+
+			drawCube (snapshot->py - 1, snapshot->px + 1, 7, GL_LINE_LOOP );
+			drawCube (snapshot->py - 1, snapshot->px + 2, 7, GL_LINE_LOOP );
+			drawCube (snapshot->py - 2, snapshot->px + 1, 7, GL_LINE_LOOP );
+			drawCube (snapshot->py - 2, snapshot->px + 2, 7, GL_LINE_LOOP );
+	    glPopMatrix();
+		glAccum(GL_ACCUM, iterFrac);
+		
+		//glDrawBuffer(GL_FRONT);
+	//    glAccum(GL_RETURN, 1.0);
+	//    glDrawBuffer(GL_BACK);
+	}
+}
+
+void Renderer::drawFloor()
+{
+	// Draw Floor
+	useTexture(floorTexId);
+	glNormal3f(0.0, 1.0, 0.0);
+	glColor3d(1, 1, 1);
+	drawStaticGeometry(floorRange);
+}
+// Append one vertex to a T2F_N3F_V3F vertex array
+static void addVertex(std::vector<GLfloat> &verts, float s, float t, float nx, float ny, float nz, float x, float y, float z)
+{
+	GLfloat v[8] = { s, t, nx, ny, nz, x, y, z };
+	verts.insert(verts.end(), v, v + 8);
+}
+
+static void addQuad(std::vector<GLfloat> &verts, float x0, float y0, float x1, float y1, float z)
+{
+	addVertex(verts, 0, 0, 0, 0, 1, x0, y0, z);
+	addVertex(verts, 0, 0, 0, 0, 1, x1, y0, z);
+	addVertex(verts, 0, 0, 0, 0, 1, x1, y1, z);
+	addVertex(verts, 0, 0, 0, 0, 1, x0, y1, z);
+}
+
+void Renderer::bakeStaticGeometry(int width, int height)
+{
+	// Everything in the scene that never moves is packed into one vertex
+	// buffer. Each part remembers its primitive type and vertex range so the
+	// draw routines only have to bind their textures and issue a single
+	// glDrawArrays.
+	std::vector<GLfloat> verts;
+	GeometryRange range;
+	
+	// Background
+	range.mode = GL_QUADS;
+	range.first = verts.size() / 8;
+	range.normals = false;
+	addVertex(verts, 0, 0, 0, 0, 1, -9, 0, -10);
+	addVertex(verts, 0, 1, 0, 0, 1, -9, 17, -10);
+	addVertex(verts, 1, 1, 0, 0, 1, 29, 17, -10);
+	addVertex(verts, 1, 0, 0, 0, 1, 29, 0, -10);
+	range.count = verts.size() / 8 - range.first;
+	backgroundRange = range;
+	
+	// Floor
+	range.first = verts.size() / 8;
+	addVertex(verts, 0, 0, 0, 1, 0, -100, 0, -100);
+	addVertex(verts, 0, 10, 0, 1, 0, -100, 0, 100);
+	addVertex(verts, 10, 10, 0, 1, 0, 100, 0, 100);
+	addVertex(verts, 10, 0, 0, 1, 0, 100, 0, -100);
+	range.count = verts.size() / 8 - range.first;
+	floorRange = range;
+	
+	// Grid lines
+	range.mode = GL_LINES;
+	range.first = verts.size() / 8;
+	for (int i = 0;i<=width;i++)
+	{
+		addVertex(verts, 0, 0, 0, 0, 1, i, 0, 1);
+		addVertex(verts, 0, 0, 0, 0, 1, i, height, 1);
+	}
+	for (int i = 0;i<=height;i++)
+	{
+		addVertex(verts, 0, 0, 0, 0, 1, 0, i, 1);
+		addVertex(verts, 0, 0, 0, 0, 1, width, i, 1);
+	}
+	range.count = verts.size() / 8 - range.first;
+	gridLinesRange = range;
+	
+	// Grid intersections and the notches on the sides of the well
+	float squareLength = 0.07;
+	range.mode = GL_QUADS;
+	range.first = verts.size() / 8;
+	for (int i = 1;i<width;i++)
+	{
+		for (int j=1;j<height;j++)
+			addQuad(verts, i - squareLength, j - squareLength, i + squareLength, j + squareLength, 1);
+	}
+	for (int i = 1;i<height;i++)
+	{
+		addQuad(verts, 0, i - squareLength, squareLength, i + squareLength, 1);
+		addQuad(verts, width - squareLength, i - squareLength, width, i + squareLength, 1);
+	}
+	range.count = verts.size() / 8 - range.first;
+	gridDotsRange = range;
+	
+	// Border around the well
+	float buffer = 1.f;
+	range.mode = GL_LINES;
+	range.first = verts.size() / 8;
+	addVertex(verts, 0, 0, 0, 0, 1, -buffer, 0, 1);
+	addVertex(verts, 0, 0, 0, 0, 1, -buffer, height, 1);
+	addVertex(verts, 0, 0, 0, 0, 1, width + buffer, 0, 1);
+	addVertex(verts, 0, 0, 0, 0, 1, width + buffer, height, 1);
+	addVertex(verts, 0, 0, 0, 0, 1, -buffer, 0, 1);
+	addVertex(verts, 0, 0, 0, 0, 1, width + buffer, 0, 1);
+	range.count = verts.size() / 8 - range.first;
+	gridBorderRange = range;
+	
+	// Clear bar, translated into place when it is drawn
+	range.mode = GL_LINE_LOOP;
+	range.first = verts.size() / 8;
+	addVertex(verts, 0, 0, 0, 0, 1, 0, 0, 0);
+	addVertex(verts, 0, 0, 0, 0, 1, 0, 0, 1);
+	addVertex(verts, 0, 0, 0, 0, 1, 0, height, 1);
+	addVertex(verts, 0, 0, 0, 0, 1, 0, height, 0);
+	range.count = verts.size() / 8 - range.first;
+	barRange = range;
+	
+	// Room
+	range.mode = GL_QUADS;
+	range.first = verts.size() / 8;
+	range.normals = true;
+	// Floor
+	addVertex(verts, 0, 0, 0, 1, 0, -4, 0, -20);
+	addVertex(verts, 0, 0, 0, 1, 0, -4, 0, 20);
+	addVertex(verts, 0, 0, 0, 1, 0, 20, 0, 20);
+	addVertex(verts, 0, 0, 0, 1, 0, 20, 0, -20);
+	// Ceiling
+	addVertex(verts, 0, 0, 0, -1, 0, -4, 20, 20);
+	addVertex(verts, 0, 0, 0, -1, 0, -4, 20, -20);
+	addVertex(verts, 0, 0, 0, -1, 0, 20, 20, -20);
+	addVertex(verts, 0, 0, 0, -1, 0, 20, 20, 20);
+	// Front Wall
+	addVertex(verts, 0, 0, 0, 0, 1, -4, 20, -20);
+	addVertex(verts, 0, 0, 0, 0, 1, -4, 0, -20);
+	addVertex(verts, 0, 0, 0, 0, 1, 20, 0, -20);
+	addVertex(verts, 0, 0, 0, 0, 1, 20, 20, -20);
+	// Left Wall
+	addVertex(verts, 0, 0, 1, 0, 0, -4, 20, 20);
+	addVertex(verts, 0, 0, 1, 0, 0, -4, 0, 20);
+	addVertex(verts, 0, 0, 1, 0, 0, -4, 0, -20);
+	addVertex(verts, 0, 0, 1, 0, 0, -4, 20, -20);
+	// Right Wall
+	addVertex(verts, 0, 0, -1, 0, 0, 20, 20, -20);
+	addVertex(verts, 0, 0, -1, 0, 0, 20, 0, -20);
+	addVertex(verts, 0, 0, -1, 0, 0, 20, 0, 20);
+	addVertex(verts, 0, 0, -1, 0, 0, 20, 20, 20);
+	range.count = verts.size() / 8 - range.first;
+	roomRange = range;
+	
+	glState.bindBuffer(GL_ARRAY_BUFFER, staticGeometryBuffer);
+	glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(GLfloat), &verts[0], GL_STATIC_DRAW);
+}
+
+void Renderer::beginStaticGeometry()
+{
+	// Nothing else draws from arrays, so the buffer and arrays are left set
+	// up from one frame to the next and the cache skips all but the pointers
+	GLsizei stride = 8 * sizeof(GLfloat);
+	glState.bindBuffer(GL_ARRAY_BUFFER, staticGeometryBuffer);
+	glState.enableClientState(GL_VERTEX_ARRAY);
+	glState.enableClientState(GL_TEXTURE_COORD_ARRAY);
+	glTexCoordPointer(2, GL_FLOAT, stride, (GLvoid *)0);
+	glNormalPointer(GL_FLOAT, stride, (GLvoid *)(2 * sizeof(GLfloat)));
+	glVertexPointer(3, GL_FLOAT, stride, (GLvoid *)(5 * sizeof(GLfloat)));
+}
+
+void Renderer::drawStaticGeometry(const GeometryRange &range)
+{
+	// Parts without normals are lit with the current normal instead
+	if (range.normals)
+		glState.enableClientState(GL_NORMAL_ARRAY);
+	else
+		glState.disableClientState(GL_NORMAL_ARRAY);
+	glDrawArrays(range.mode, range.first, range.count);
+}
+
+// What to draw in a cell of the well: the block settled there, or else
+// the falling piece, which is drawn part of the way to the row below so
+// it falls smoothly between ticks. y is where to draw it.
+int Renderer::cellColour(int row, int col, float &y)
+{
+	y = row;
+	if (snapshot->get(row, col) != -1)
+		return snapshot->get(row, col);
+	
+	y = row - snapshot->fallFraction;
+	return snapshot->getPieceCell(row, col);
+}
+
+void Renderer::drawGameboard(bool draw3D)
+{	
+	// Bump mapped cubes all share the same texture unit setup, so draw them
+	// in a single pass before the outlines
+	if (loadBumpMapping)
+	{
+		beginBumpMapping();
+		for (int i = WELL_HEIGHT+3;i>=0;i--) // row
+		{
+			for (int j = WELL_WIDTH - 1; j>=0;j--) // column
+			{
+				float y;
+				int colour = cellColour(i, j, y);
+				if (colour != -1)
+					drawBumpCube (y, j, colour, draw3D );
+			}
+		}
+		endBumpMapping();
+	}
+	
+	// Rows each half of the falling piece will land on, outlined along
+	// with the blocks
+	const int *ghostRow = snapshot->ghostRow;
+	
+	for (int i = WELL_HEIGHT+3;i>=0;i--) // row
+	{
+		for (int j = WELL_WIDTH - 1; j>=0;j--) // column
+		{				
+			float y;
+			int colour = cellColour(i, j, y);
+			int side = j - (snapshot->px + 1);
+			bool ghost = (side == 0 || side == 1) && colour == -1
+				&& (i == ghostRow[side] - 1 || i == ghostRow[side] - 2);
+			
+			if(!loadBumpMapping && colour != -1)
+			{
+				glPushMatrix();
+					glTranslatef(j, y, 0);
+					drawCube (i, j, colour, GL_QUADS, draw3D );
+				glPopMatrix();
+			}
+				
+				
+			// Draw outline for cube
+			if (colour != -1 || ghost)
+			{
+				glPushMatrix();
+					glTranslatef(j, ghost ? i : y, 0);
+					drawCube(i, j, 7, GL_LINE_LOOP, draw3D);
+				glPopMatrix();
+			}
+
+		}
+	}	
+	
+	// Draw next piece
+	const int *nextPieceCol = snapshot->nextPieceColour;
+	glPushMatrix();
+		glTranslatef(19, 2, 0);
+		drawCube(2, 19, nextPieceCol[0], GL_QUADS, draw3D);
+	glPopMatrix();
+	glPushMatrix();
+		glTranslatef(20, 2, 0);
+		drawCube(2, 20, nextPieceCol[1], GL_QUADS, draw3D);
+	glPopMatrix();
+	glPushMatrix();
+		glTranslatef(19, 1, 0);
+		drawCube(1, 19, nextPieceCol[2], GL_QUADS, draw3D);
+	glPopMatrix();
+	glPushMatrix();
+		glTranslatef(20, 1, 0);
+		drawCube(1, 20, nextPieceCol[3], GL_QUADS, draw3D);
+	glPopMatrix();
+	
+	// drawCube leaves blending on for translucent cubes. The reflection
+	// pass manages blending itself.
+	if (transluceny && draw3D)
+		glState.disable(GL_BLEND);
+}
+void Renderer::resizeGL(int width, int height)
+{
+  // Set up perspective projection, using current size and aspect
+  // ratio of display
+
+  glMatrixMode(GL_PROJECTION);
+  glLoadIdentity();
+  glViewport(0, 0, width, height);
+  gluPerspective(FIELD_OF_VIEW, (GLfloat)width/(GLfloat)height, 0.1, 1000.0);
+  viewHeight = height;
+
+  // Reset to modelview matrix mode
+  
+  glMatrixMode(GL_MODELVIEW);
+}
+
+void Renderer::drawBumpCube(float y, float x, int colourId, bool draw3D)
+{
+	// The texture units are set up once per pass by beginBumpMapping, all
+	// that changes from cube to cube is the skin.
+	if (bumpProgram)
+	{
+		glState.bindTexture(GL_TEXTURE_2D, texture[colourId - 1]);
+		glPushMatrix();
+			glTranslatef(x, y, 0);
+			glCallList(draw3D ? bumpCubeDisplayList : bumpCubeDisplayList + 1);
+		glPopMatrix();
+		return;
+	}
+	
+	glState.activeTexture(GL_TEXTURE2);
+	glState.bindTexture(GL_TEXTURE_2D, texture[colourId - 1]);
+
+	// Now We Draw Our Object (Remember That We First Have To Calculate The
+	// (UnNormalized) Vector From Each Vertex To Our Light).
+
+	double innerXMin = 0;
+	double innerYMin = 0;
+	double innerXMax = 1;
+	double innerYMax = 1;
+	double zMax = 1;
+	double zMin = 0;
+	
+	Point3D vertex_position, light_position;
+	light_position[0] = lightPos[0];
+	light_position[1] = lightPos[1];
+	light_position[2] = lightPos[2];
+	Vector3D vertex_to_light;
+	glBegin(GL_QUADS);
+		// lower left Vertex
+		vertex_position = Point3D(innerXMin + x, innerYMin + y, zMax);
+		vertex_to_light = light_position - vertex_position;
+		glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+		glMultiTexCoord2f(GL_TEXTURE1, 0.0f, 0.0f);
+		glMultiTexCoord2f(GL_TEXTURE2, 0.0f, 0.0f);
+		glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+
+
+		vertex_position = Point3D(innerXMax + x, innerYMin + y, zMax);
+		vertex_to_light = light_position - vertex_position;
+		glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+		glMultiTexCoord2f(GL_TEXTURE1, 1.0f, 0.0f);
+		glMultiTexCoord2f(GL_TEXTURE2, 1.0f, 0.0f);
+		glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+
+        vertex_position = Point3D(innerXMax + x, innerYMax + y, zMax);
+		vertex_to_light = light_position - vertex_position;
+		glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+		glMultiTexCoord2f(GL_TEXTURE1, 1.0f, 1.0f);
+		glMultiTexCoord2f(GL_TEXTURE2, 1.0f, 1.0f);
+		glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+
+
+		// upper left Vertex
+		vertex_position = Point3D(innerXMin + x, innerYMax + y, zMax);
+		vertex_to_light = light_position - vertex_position;
+		glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+		glMultiTexCoord2f(GL_TEXTURE1, 0.0f, 1.0f);
+		glMultiTexCoord2f(GL_TEXTURE2, 0.0f, 1.0f);
+		glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+	glEnd();
+	
+	if (draw3D)
+	{
+		glBegin(GL_QUADS);
+			// lower left Vertex
+			vertex_position = Point3D(innerXMin + x, innerYMax + y, zMin);
+			vertex_to_light = light_position - vertex_position;
+			glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+			glMultiTexCoord2f(GL_TEXTURE1, 0.0f, 0.0f);
+			glMultiTexCoord2f(GL_TEXTURE2, 0.0f, 0.0f);
+			glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+
+
+			vertex_position = Point3D(innerXMax + x, innerYMax + y, zMin);
+			vertex_to_light = light_position - vertex_position;
+			glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+			glMultiTexCoord2f(GL_TEXTURE1, 1.0f, 0.0f);
+			glMultiTexCoord2f(GL_TEXTURE2, 1.0f, 0.0f);
+			glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+
+	        vertex_position = Point3D(innerXMax + x, innerYMax + y, zMax);
+			vertex_to_light = light_position - vertex_position;
+			glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+			glMultiTexCoord2f(GL_TEXTURE1, 1.0f, 1.0f);
+			glMultiTexCoord2f(GL_TEXTURE2, 1.0f, 1.0f);
+			glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+
+
+			// upper left Vertex
+			vertex_position = Point3D(innerXMin + x, innerYMax + y, zMax);
+			vertex_to_light = light_position - vertex_position;
+			glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+			glMultiTexCoord2f(GL_TEXTURE1, 0.0f, 1.0f);
+			glMultiTexCoord2f(GL_TEXTURE2, 0.0f, 1.0f);
+			glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+		glEnd();
+
+		glBegin(GL_QUADS);
+			// lower left Vertex
+			vertex_position = Point3D(innerXMin + x, innerYMin + y, zMin);
+			vertex_to_light = light_position - vertex_position;
+			glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+			glMultiTexCoord2f(GL_TEXTURE1, 0.0f, 0.0f);
+			glMultiTexCoord2f(GL_TEXTURE2, 0.0f, 0.0f);
+			glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+
+
+			vertex_position = Point3D(innerXMin + x, innerYMax + y, zMin);
+			vertex_to_light = light_position - vertex_position;
+			glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+			glMultiTexCoord2f(GL_TEXTURE1, 1.0f, 0.0f);
+			glMultiTexCoord2f(GL_TEXTURE2, 1.0f, 0.0f);
+			glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+
+	        vertex_position = Point3D(innerXMin + x, innerYMax + y, zMax);
+			vertex_to_light = light_position - vertex_position;
+			glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+			glMultiTexCoord2f(GL_TEXTURE1, 1.0f, 1.0f);
+			glMultiTexCoord2f(GL_TEXTURE2, 1.0f, 1.0f);
+			glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+
+
+			// upper left Vertex
+			vertex_position = Point3D(innerXMin + x, innerYMin + y, zMax);
+			vertex_to_light = light_position - vertex_position;
+			glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+			glMultiTexCoord2f(GL_TEXTURE1, 0.0f, 1.0f);
+			glMultiTexCoord2f(GL_TEXTURE2, 0.0f, 1.0f);
+			glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+		glEnd();
+
+		glBegin(GL_QUADS);
+			// lower left Vertex
+			vertex_position = Point3D(innerXMax + x, innerYMin + y, zMin);
+			vertex_to_light = light_position - vertex_position;
+			glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+			glMultiTexCoord2f(GL_TEXTURE1, 0.0f, 0.0f);
+			glMultiTexCoord2f(GL_TEXTURE2, 0.0f, 0.0f);
+			glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+
+
+			vertex_position = Point3D(innerXMax + x, innerYMax + y, zMin);
+			vertex_to_light = light_position - vertex_position;
+			glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+			glMultiTexCoord2f(GL_TEXTURE1, 1.0f, 0.0f);
+			glMultiTexCoord2f(GL_TEXTURE2, 1.0f, 0.0f);
+			glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+
+	        vertex_position = Point3D(innerXMax + x, innerYMax + y, zMax);
+			vertex_to_light = light_position - vertex_position;
+			glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+			glMultiTexCoord2f(GL_TEXTURE1, 1.0f, 1.0f);
+			glMultiTexCoord2f(GL_TEXTURE2, 1.0f, 1.0f);
+			glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+
+
+			// upper left Vertex
+			vertex_position = Point3D(innerXMax + x, innerYMin + y, zMax);
+			vertex_to_light = light_position - vertex_position;
+			glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+			glMultiTexCoord2f(GL_TEXTURE1, 0.0f, 1.0f);
+			glMultiTexCoord2f(GL_TEXTURE2, 0.0f, 1.0f);
+			glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+		glEnd();
+
+		glBegin(GL_QUADS);
+			// lower left Vertex
+			vertex_position = Point3D(innerXMin + x, innerYMin + y, zMin);
+			vertex_to_light = light_position - vertex_position;
+			glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+			glMultiTexCoord2f(GL_TEXTURE1, 0.0f, 0.0f);
+			glMultiTexCoord2f(GL_TEXTURE2, 0.0f, 0.0f);
+			glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+
+
+			vertex_position = Point3D(innerXMax + x, innerYMin + y, zMin);
+			vertex_to_light = light_position - vertex_position;
+			glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+			glMultiTexCoord2f(GL_TEXTURE1, 1.0f, 0.0f);
+			glMultiTexCoord2f(GL_TEXTURE2, 1.0f, 0.0f);
+			glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+
+	        vertex_position = Point3D(innerXMax + x, innerYMax + y, zMin);
+			vertex_to_light = light_position - vertex_position;
+			glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+			glMultiTexCoord2f(GL_TEXTURE1, 1.0f, 1.0f);
+			glMultiTexCoord2f(GL_TEXTURE2, 1.0f, 1.0f);
+			glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+
+
+			// upper left Vertex
+			vertex_position = Point3D(innerXMin + x, innerYMax + y, zMin);
+			vertex_to_light = light_position - vertex_position;
+			glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+			glMultiTexCoord2f(GL_TEXTURE1, 0.0f, 1.0f);
+			glMultiTexCoord2f(GL_TEXTURE2, 0.0f, 1.0f);
+			glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+		glEnd();
+
+		glBegin(GL_QUADS);
+			// lower left Vertex
+			vertex_position = Point3D(innerXMin + x, innerYMin + y, zMin);
+			vertex_to_light = light_position - vertex_position;
+			glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+			glMultiTexCoord2f(GL_TEXTURE1, 0.0f, 0.0f);
+			glMultiTexCoord2f(GL_TEXTURE2, 0.0f, 0.0f);
+			glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+
+
+			vertex_position = Point3D(innerXMax + x, innerYMin + y, zMin);
+			vertex_to_light = light_position - vertex_position;
+			glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+			glMultiTexCoord2f(GL_TEXTURE1, 1.0f, 0.0f);
+			glMultiTexCoord2f(GL_TEXTURE2, 1.0f, 0.0f);
+			glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+
+	        vertex_position = Point3D(innerXMax + x, innerYMin + y, zMax);
+			vertex_to_light = light_position - vertex_position;
+			glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+			glMultiTexCoord2f(GL_TEXTURE1, 1.0f, 1.0f);
+			glMultiTexCoord2f(GL_TEXTURE2, 1.0f, 1.0f);
+			glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+
+
+			// upper left Vertex
+			vertex_position = Point3D(innerXMin + x, innerYMin + y, zMax);
+			vertex_to_light = light_position - vertex_position;
+			glMultiTexCoord3f(GL_TEXTURE0, vertex_to_light[0], vertex_to_light[1], vertex_to_light[2]);
+			glMultiTexCoord2f(GL_TEXTURE1, 0.0f, 1.0f);
+			glMultiTexCoord2f(GL_TEXTURE2, 0.0f, 1.0f);
+			glVertex3f(vertex_position[0], vertex_position[1], vertex_position[2]);
+		glEnd();	
+	}
+}
+
+void Renderer::beginBumpMapping()
+{
+	if (bumpProgram)
+	{
+		// The shader works in eye space, so move the light there once for
+		// the whole pass instead of once per vertex
+		GLfloat m[16];
+		glGetFloatv(GL_MODELVIEW_MATRIX, m);
+		GLfloat lightEye[3];
+		for (int i = 0;i<3;i++)
+			lightEye[i] = m[i] * lightPos[0] + m[4+i] * lightPos[1] + m[8+i] * lightPos[2] + m[12+i];
+
+		glState.useProgram(bumpProgram);
+		glUniform3fv(bumpLightUniform, 1, lightEye);
+		glState.activeTexture(GL_TEXTURE1);
+		glState.bindTexture(GL_TEXTURE_2D, bumpMap);
+		glState.activeTexture(GL_TEXTURE0);
+		return;
+	}
+	
+	if (!cube)
+		GenNormalizationCubeMap(256, cube);
+	
+	// Set The First Texture Unit To Normalize Our Vector From The Surface To The Light.
+	// Set The Texture Environment Of The First Texture Unit To Replace It With The
+	// Sampled Value Of The Normalization Cube Map.
+	glState.activeTexture(GL_TEXTURE0);
+	glState.enable(GL_TEXTURE_CUBE_MAP);
+	glState.bindTexture(GL_TEXTURE_CUBE_MAP, cube);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
+	glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_REPLACE) ;
+	glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_RGB, GL_TEXTURE) ;
+
+	// Set The Second Unit To The Bump Map.
+	// Set The Texture Environment Of The Second Texture Unit To Perform A Dot3
+	// Operation With The Value Of The Previous Texture Unit (The Normalized
+	// Vector Form The Surface To The Light) And The Sampled Texture Value (The
+	// Normalized Normal Vector Of Our Bump Map).
+	glState.activeTexture(GL_TEXTURE1);
+	glState.enable(GL_TEXTURE_2D);
+	glState.bindTexture(GL_TEXTURE_2D, bumpMap);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_COMBINE);
+	glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_DOT3_RGB) ;
+	glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_RGB, GL_PREVIOUS) ;
+	glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE1_RGB, GL_TEXTURE) ;
+
+	// Set The Third Texture Unit To Our Texture.
+	// Set The Texture Environment Of The Third Texture Unit To Modulate
+	// (Multiply) The Result Of Our Dot3 Operation With The Texture Value.
+	glState.activeTexture(GL_TEXTURE2);
+	glState.enable(GL_TEXTURE_2D);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+}
+
+void Renderer::endBumpMapping()
+{
+	if (bumpProgram)
+	{
+		glState.useProgram(0);
+		return;
+	}
+	
+	glState.activeTexture(GL_TEXTURE0);
+	glState.disable(GL_TEXTURE_CUBE_MAP);
+
+	glState.activeTexture(GL_TEXTURE1);
+	glState.disable(GL_TEXTURE_2D);
+	
+	glState.activeTexture(GL_TEXTURE2);
+	glState.disable(GL_TEXTURE_2D);
+	
+	glState.activeTexture(GL_TEXTURE0);
+}
+void Renderer::drawCube(float y, float x, int colourId, GLenum mode, bool draw3D)
+{
+	if (mode == GL_LINE_LOOP)
+		glLineWidth (1.2);
+			
+	double r, g, b;
+	r = 0;
+	g = 0;
+	b = 0;
+	switch (colourId)
+	{
+		case 0:	// blue
+			r = 0.514;
+			g = 0.839;
+			b = 0.965;
+			break;              
+		case 1:	// purple       
+			r = 0.553;          
+			g = 0.6;            
+			b = 0.796;          
+			break;              
+		case 2: // orange       
+			r = 0.988;          
+			g = 0.627;          
+			b = 0.373;          
+			break;              
+		case 3:	// green        
+			r = 0.69;           
+			g = 0.835;          
+			b = 0.529;          
+			break;              
+		case 4:	// red          
+			r = 1.00;           
+			g = 0.453;          
+			b = 0.339;          
+			break;              
+		case 5:	// pink         
+			r = 0.949;          
+			g = 0.388;          
+			b = 0.639;          
+			break;              
+		case 6:	// yellow       
+			r = 1;              
+			g = 0.792;          
+			b = 0.204;          
+			break;
+		case 7:	// black
+			r = 0;
+			g = r;
+			b = g;
+			break;
+		default:
+			return;
+	}
+	
+	double innerXMin = 0;
+	double innerYMin = 0;
+	double innerXMax = 1;
+	double innerYMax = 1;
+	double zMax = 1;
+	double zMin = 0;
+	
+	if (transluceny)
+	{
+		glColor4f(1.0f,1.0f,1.0f,0.5f);
+		glState.enable(GL_BLEND);
+		glState.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	} 
+	
+	glNormal3d(1, 0, 0);
+	
+	if (loadTexture && colourId != 7)
+	{		
+		useTexture(texture[colourId - 1]);
+	}
+
+	else if (loadTexture && colourId == 7)
+	{
+		useTexture(texture[4]);
+	}	
+	else
+	{
+		useTexture(0);
+		glColor3d(r, g, b);
+	}
+	
+
+	if (mode == GL_LINE_LOOP && draw3D)
+	{
+		glCallList(outlineDisplayList);
+	}
+	else if (draw3D)
+	{
+		glCallList(texCubeDisplayList);
+	}
+	else if (!draw3D)
+	{
+		glCallList(reflectCubeDisplayList);
+	}
+/*
+
+	if (draw3D)
+	{
+		// top face
+		glNormal3d(0, 1, 0);
+
+		glBegin(mode);
+		 	glTexCoord2f(0.0f, 0.0f);
+			glVertex3d(innerXMin + x, innerYMax + y, zMin);
+			glTexCoord2f(1.0f, 0.0f);
+			glVertex3d(innerXMax + x, innerYMax + y, zMin);
+			glTexCoord2f(1.0f, 1.0f);
+			glVertex3d(innerXMax + x, innerYMax + y, zMax);
+			glTexCoord2f(0.0f, 1.0f);
+			glVertex3d(innerXMin + x, innerYMax + y, zMax);
+		glEnd();
+
+		// left face
+		glNormal3d(0, 0, -1);
+
+		glBegin(mode);
+			glTexCoord2f(0.0f, 0.0f);
+			glVertex3d(innerXMin + x, innerYMin + y, zMin);
+			glTexCoord2f(1.0f, 0.0f);
+			glVertex3d(innerXMin + x, innerYMax + y, zMin);
+			glTexCoord2f(1.0f, 1.0f);
+			glVertex3d(innerXMin + x, innerYMax + y, zMax);
+			glTexCoord2f(0.0f, 1.0f);
+			glVertex3d(innerXMin + x, innerYMin + y, zMax);
+		glEnd();
+
+		// bottom face
+		glNormal3d(0, -1, 0);
+
+		glBegin(mode);
+			glTexCoord2f(0.0f, 0.0f);
+			glVertex3d(innerXMin + x, innerYMin + y, zMin);
+			glTexCoord2f(1.0f, 0.0f);
+			glVertex3d(innerXMax + x, innerYMin + y, zMin);
+			glTexCoord2f(1.0f, 1.0f);
+			glVertex3d(innerXMax + x, innerYMin + y, zMax);
+			glTexCoord2f(0.0f, 1.0f);
+			glVertex3d(innerXMin + x, innerYMin + y, zMax);
+		glEnd();
+
+		// right face
+		glNormal3d(0, 0, 1);
+
+		glBegin(mode);
+			glTexCoord2f(0.0f, 0.0f);
+			glVertex3d(innerXMax + x, innerYMin + y, zMin);
+			glTexCoord2f(1.0f, 0.0f);
+			glVertex3d(innerXMax + x, innerYMax + y, zMin);
+			glTexCoord2f(1.0f, 1.0f);
+			glVertex3d(innerXMax + x, innerYMax + y, zMax);
+			glTexCoord2f(0.0f, 1.0f);
+			glVertex3d(innerXMax + x, innerYMin + y, zMax);
+		glEnd();
+
+		// Back of front face
+		glNormal3d(-1, 0, 0);
+
+		glBegin(mode);
+			glTexCoord2f(0.0f, 0.0f);
+			glVertex3d(innerXMin + x, innerYMin + y, zMin);
+			glTexCoord2f(1.0f, 0.0f);
+			glVertex3d(innerXMax + x, innerYMin + y, zMin);
+			glTexCoord2f(1.0f, 1.0f);	
+			glVertex3d(innerXMax + x, innerYMax + y, zMin);
+			glTexCoord2f(0.0f, 1.0f);
+			glVertex3d(innerXMin + x, innerYMax + y, zMin);
+		glEnd();
+	
+	}
+*/
+}
+
+void Renderer::setRenderOptions(int options)
+{
+	loadTexture = options & TEXTURES;
+	loadBumpMapping = options & BUMP_MAPPING;
+	transluceny = options & TRANSLUCENCY;
+	drawShadow = options & SHADOWS;
+	motionBlur = options & MOTION_BLUR;
+}
+
+int Renderer::getRenderOptions() const
+{
+	return (loadTexture ? TEXTURES : 0) | (loadBumpMapping ? BUMP_MAPPING : 0)
+		| (transluceny ? TRANSLUCENCY : 0) | (drawShadow ? SHADOWS : 0)
+		| (motionBlur ? MOTION_BLUR : 0);
+}
+
+void Renderer::setDrawMode(DrawMode mode)
+{
+	currentDrawMode = mode;
+}
+
+void Renderer::setSnapshot(const GameSnapshot *newSnapshot)
+{
+	snapshot = newSnapshot;
+}
+
+void Renderer::gameEvent(const GameEvent &event)
+{
+	switch (event.type)
+	{
+		case GameEvent::CELL_CLEARED:
+			addParticleBox(event.c, event.r, event.value);
+			break;
+		case GameEvent::LEVEL_UP:
+			if (!singleSkinMode)
+			{
+				setLevelTextures(std::min(event.value + 1, NUM_TEXTURES));
+				levelUpAnimation = true;
+			}
+			break;
+		case GameEvent::SWEEP_FINISHED:
+			if (event.value > 5)
+				setAnimation(happyAnimation);
+			break;
+		case GameEvent::GAME_OVER:
+			setAnimation(sadAnimation);
+			break;
+	}
+}
+
+void Renderer::resetScene()
+{
+	setAnimation(neutralAnimation);
+	setLevelTextures(1);
+}
+
+bool Renderer::particlesMoving() const
+{
+	return !particles.empty() || levelUpAnimation;
+}
+
+bool Renderer::mascotMoving() const
+{
+	return !startScreen && animations.get(currentAnimation).isAnimated();
+}
+
+void Renderer::updateProfile(double frameStart)
+{
+	profileFrames++;
+	profileFrameTime += currentTime() - frameStart;
+	
+	double elapsed = currentTime() - profileStart;
+	if (elapsed < 1.0)
+		return;
+		
+	if (showProfile)
+	{
+		std::cout << "fps: " << profileFrames / elapsed
+				  << "\tms/frame: " << 1000.0 * profileFrameTime / profileFrames
+				  << "\tstate changes/frame: " << glState.getIssued() / profileFrames
+				  << " issued, " << glState.getSkipped() / profileFrames << " skipped"
+				  << std::endl;
+	}
+	
+	profileStart = currentTime();
+	profileFrames = 0;
+	profileFrameTime = 0;
+	glState.resetCounters();
+}
+
+void Renderer::drawStartScreen(bool pick)
+{
+	if (pick)
+		glPushName(playButtonTex);
+
+	useTexture(playButtonTex);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
+	glBegin(GL_QUADS);
+		glTexCoord2f(0.0f, 0.0f);
+		glVertex3d(8, 8, 0);
+		glTexCoord2f(1.0f, 0.0f);
+		glVertex3d(12, 8, 0);
+		glTexCoord2f(1.0f, 1.0f);	
+		glVertex3d(12, 10, 0);
+		glTexCoord2f(0.0f, 1.0f);
+		glVertex3d(8, 10, 0);
+	glEnd();
+	if (pick)
+	{
+		glPopName();
+		glPushName(soundOnTex);
+	}
+	
+	useTexture(soundOnTex);
+	glBegin(GL_QUADS);
+		glTexCoord2f(0.0f, 0.0f);
+		glVertex3d(8, 5, 0);
+		glTexCoord2f(1.0f, 0.0f);
+		glVertex3d(12, 5, 0);
+		glTexCoord2f(1.0f, 1.0f);	
+		glVertex3d(12, 7, 0);
+		glTexCoord2f(0.0f, 1.0f);
+		glVertex3d(8, 7, 0);
+	glEnd();
+	if (pick)
+	{
+		glPopName();
+		glPushName(singleSkinModeTex);
+	}
+	
+	useTexture(singleSkinModeTex);
+	glBegin(GL_QUADS);
+		glTexCoord2f(0.0f, 0.0f);
+		glVertex3d(8, 2, 0);
+		glTexCoord2f(1.0f, 0.0f);
+		glVertex3d(12, 2, 0);
+		glTexCoord2f(1.0f, 1.0f);	
+		glVertex3d(12, 4, 0);
+		glTexCoord2f(0.0f, 1.0f);
+		glVertex3d(8, 4, 0);
+	glEnd();
+	useTexture(0);
+	
+	if (pick)
+		glPopName();
+}
+
+Renderer::StartButton Renderer::pickStartScreen(int x, int y)
+{
+	GLuint buff[16] = {0};
+ 	GLint hits, view[4];
+
+	glSelectBuffer(16,buff);
+	glRenderMode(GL_SELECT);
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+		glLoadIdentity();
+		glGetIntegerv(GL_VIEWPORT,view);
+		gluPickMatrix(x, view[3] - y, 1, 1, view);			
+		gluPerspective(FIELD_OF_VIEW, (GLfloat)view[2]/(GLfloat)view[3], 0.1, 1000.0);
+		glTranslated(CAMERA_X, CAMERA_Y, CAMERA_Z);
+
+		glMatrixMode(GL_MODELVIEW);
+		glLoadIdentity();
+		glTranslated(-7.5, -10.0, 7.0);
+		glInitNames();
+		glPushName(0);
+			drawStartScreen(true);
+		glPopName();
+		glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glFlush();
+
+	// returning to normal rendering mode
+	hits = glRenderMode(GL_RENDER);
+	if (hits <= 0)
+		return NO_BUTTON;
+
+	// The name of the nearest hit
+	GLuint names, *ptr, minZ,*ptrNames, numberOfNames;
+
+	ptr = (GLuint *) buff;
+	minZ = 0xffffffff;
+	for (int i = 0; i < hits; i++) 
+	{	
+		names = *ptr;
+		ptr++;
+		if (*ptr < minZ) 
+		{
+			numberOfNames = names;
+			minZ = *ptr;
+			ptrNames = ptr+2;
+		}
+
+		ptr += names+2;
+	}
+	ptr = ptrNames + numberOfNames - 1;
+
+	// Swap in the pressed (or, for the toggles, the other) look
+	StartButton button = NO_BUTTON;
+	if (*ptr == playButtonTex)
+	{
+		playButtonTex = playButtonClickedTex;
+		button = PLAY_BUTTON;
+	}
+	else if (*ptr == soundOnTex)
+	{
+		GLuint temp;
+		temp = soundOnTex;
+		soundOnTex = soundOffTex;
+		soundOffTex = temp;
+		button = SOUND_BUTTON;
+	}
+	else if (*ptr == singleSkinModeTex)
+	{
+		GLuint temp;
+		temp = singleSkinModeTex;
+		singleSkinModeTex = singleSkinModeClickedTex;
+		singleSkinModeClickedTex = temp;
+		button = SINGLE_SKIN_BUTTON;
+	}
+	drawStartScreen(false);
+	return button;
+}
+
+// quick and dirty bitmap loader...for 24 bit bitmaps with 1 plane only.  
+// See http://www.dcs.ed.ac.uk/~mxr/gfx/2d/BMP.txt for more info.
+int Renderer::ImageLoad(const char *filename, Image *image) {
+    FILE *file;
+    unsigned long size;                 // size of the image in bytes.
+    unsigned long i;                    // standard counter.
+    unsigned short int planes;          // number of planes in image (must be 1) 
+    unsigned short int bpp;             // number of bits per pixel (must be 24)
+    char temp;                          // temporary color storage for bgr-rgb conversion.
+
+    // make sure the file is there.
+    if ((file = fopen(filename, "rb"))==NULL)
+    {
+		printf("File Not Found : %s\n",filename);
+		return 0;
+    }
+    
+    // seek through the bmp header, up to the width/height:
+    fseek(file, 18, SEEK_CUR);
+
+    // read the width
+    if ((i = fread(&image->sizeX, 4, 1, file)) != 1) {
+		printf("Error reading width from %s.\n", filename);
+		return 0;
+    }		
+    printf("Width of %s: %lu\n", filename, image->sizeX);
+    
+    // read the height 
+    if ((i = fread(&image->sizeY, 4, 1, file)) != 1) {
+		printf("Error reading height from %s.\n", filename);
+		return 0;
+    }
+    	printf("Height of %s: %lu\n", filename, image->sizeY);
+    
+    // calculate the size (assuming 24 bits or 3 bytes per pixel).
+    size = image->sizeX * image->sizeY * 3;
+
+    // read the planes
+    if ((fread(&planes, 2, 1, file)) != 1) {
+		printf("Error reading planes from %s.\n", filename);
+		return 0;
+    }
+    if (planes != 1) {
+		printf("Planes from %s is not 1: %u\n", filename, planes);
+		return 0;
+    }
+
+    // read the bpp
+    if ((i = fread(&bpp, 2, 1, file)) != 1) {
+		printf("Error reading bpp from %s.\n", filename);
+		return 0;
+    }
+    if (bpp != 24) {
+		printf("Bpp from %s is not 24: %u\n", filename, bpp);
+		return 0;
+    }
+	
+    // seek past the rest of the bitmap header.
+    fseek(file, 24, SEEK_CUR);
+
+    // read the data. 
+    image->data = (char *) malloc(size);
+    if (image->data == NULL) {
+		printf("Error allocating memory for color-corrected image data");
+		return 0;	
+    }
+
+    if ((i = fread(image->data, size, 1, file)) != 1) {
+		printf("Error reading image data from %s.\n", filename);
+		return 0;
+    }
+
+    for (i=0;i<size;i+=3) { // reverse all of the colors. (bgr -> rgb)
+	temp = image->data[i];
+	image->data[i] = image->data[i+2];
+	image->data[i+2] = temp;
+    }
+    
+    // we're done.
+    return 1;
+}
+    
+// Load Bitmaps And Convert To Textures
+int  Renderer::LoadGLTextures(const char *filename, GLuint &texid) {	
+    // Load Texture
+    Image *image1;
+    
+    // allocate space for texture
+    image1 = (Image *) malloc(sizeof(Image));
+    if (image1 == NULL) {
+		printf("Error allocating space for image");
+		exit(0);
+    }
+
+    if (!ImageLoad(filename, image1)) {
+	exit(1);
+    }        
+	
+    // Create Texture	
+	glGenTextures(1, &texid);
+    glState.bindTexture(GL_TEXTURE_2D, texid);   // 2d texture (x and y size)
+
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR); // scale linearly when image bigger than texture
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR); // scale linearly when image smalled than texture
+	glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_DECAL );
+    // 2d texture, level of detail 0 (normal), 3 components (red, green, blue), x size from image, y size from image, 
+    // border 0 (normal), rgb color data, unsigned byte data, and finally the data itself.
+    glTexImage2D(GL_TEXTURE_2D, 0, 3, image1->sizeX, image1->sizeY, 0, GL_RGB, GL_UNSIGNED_BYTE, image1->data);
+
+	free(image1->data);
+	free(image1);
+
+	numTextures++;
+	return (numTextures-1);
+}
+
+void Renderer::useTexture(GLuint texId)
+{
+	// Everything except the bump mapping pass textures through unit 0.
+	// Passing 0 turns texturing off.
+	glState.activeTexture(GL_TEXTURE0);
+	if (texId == 0)
+	{
+		glState.disable(GL_TEXTURE_2D);
+		return;
+	}
+	glState.enable(GL_TEXTURE_2D);
+	glState.bindTexture(GL_TEXTURE_2D, texId);
+}
+
+void Renderer::setLevelTextures(int level)
+{
+	for (int i = 0;i<4;i++)
+		texture[i] = levelTextures[level-1][i];
+}
+
+int Renderer::lightSphereLod()
+{
+	// Estimate how many pixels the light marker covers from how far it is
+	// from the camera, and use fewer slices the smaller it gets. The light
+	// goes through the same scale, rotations and translations as in
+	// renderFrame, worked out here rather than read back from GL. Only
+	// its depth matters.
+	double x = lightPos[0] - 7.5 + rotationAngleZ, y = lightPos[1] - 10.0, z = lightPos[2] + 7.0;
+	double ay = rotationAngleY * M_PI / 180, ax = rotationAngleX * M_PI / 180;
+	z = -x * sin(ay) + z * cos(ay);
+	z = y * sin(ax) + z * cos(ax);
+	double depth = -(scaleFactor * z + CAMERA_Z);
+	
+	// Behind the camera, as it is from the default view, it isn't seen at
+	// all
+	if (depth <= 0 || viewHeight <= 0)
+		return NUM_SPHERE_LODS - 1;
+
+	double pixelRadius = scaleFactor * LIGHT_SPHERE_RADIUS * viewHeight / 2
+		/ (tan(FIELD_OF_VIEW * M_PI / 360) * depth);
+	if (pixelRadius > 40)
+		return 0;
+	else if (pixelRadius > 12)
+		return 1;
+	return NUM_SPHERE_LODS - 1;
+}
+
+
+int Renderer::GenNormalizationCubeMap(unsigned int size, GLuint &texid)
+{
+	glGenTextures(1, &texid);
+	glState.bindTexture(GL_TEXTURE_CUBE_MAP, texid);
+
+	unsigned char* data = new unsigned char[size*size*3];
+
+	float offset = 0.5f;
+	float halfSize = size * 0.5f;
+	
+	// For each face, which of (halfSize, i, j) goes into x, y and z and
+	// with what sign. i and j are the texel column and row, centred on 0.
+	static const GLenum faces[6] = {
+		GL_TEXTURE_CUBE_MAP_POSITIVE_X, GL_TEXTURE_CUBE_MAP_NEGATIVE_X,
+		GL_TEXTURE_CUBE_MAP_POSITIVE_Y, GL_TEXTURE_CUBE_MAP_NEGATIVE_Y,
+		GL_TEXTURE_CUBE_MAP_POSITIVE_Z, GL_TEXTURE_CUBE_MAP_NEGATIVE_Z
+	};
+	static const float axes[6][3][3] = {
+		// { halfSize, i, j } weights for x, y and z
+		{ { 1, 0, 0 }, { 0, 0, 1 }, { 0, -1, 0 } },
+		{ { -1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },
+		{ { 0, 1, 0 }, { -1, 0, 0 }, { 0, 0, 1 } },
+		{ { 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, -1 } },
+		{ { 0, 1, 0 }, { 0, 0, 1 }, { 1, 0, 0 } },
+		{ { 0, -1, 0 }, { 0, 0, 1 }, { -1, 0, 0 } }
+	};
+
+	for (int f = 0;f<6;f++)
+	{
+		const float (*axis)[3] = axes[f];
+		unsigned int bytePtr = 0;
+		for(unsigned int j=0; j<size; j++)
+		{
+			float v = j + offset - halfSize;
+			for(unsigned int i=0; i<size; i++)
+			{
+				float u = i + offset - halfSize;
+				float x = axis[0][0] * halfSize + axis[0][1] * u + axis[0][2] * v;
+				float y = axis[1][0] * halfSize + axis[1][1] * u + axis[1][2] * v;
+				float z = axis[2][0] * halfSize + axis[2][1] * u + axis[2][2] * v;
+				float invLength = 1.f / sqrtf(x*x + y*y + z*z);
+
+				// Pack [-1, 1] into [0, 255] the way the DOT3 combiner expects
+				data[bytePtr] = (unsigned char)((x * invLength * 0.5f + 0.5f) * 255.0f);
+				data[bytePtr+1] = (unsigned char)((y * invLength * 0.5f + 0.5f) * 255.0f);
+				data[bytePtr+2] = (unsigned char)((z * invLength * 0.5f + 0.5f) * 255.0f);
+
+				bytePtr+=3;
+			}
+		}
+		glTexImage2D(faces[f], 0, GL_RGB8, size, size, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+	}
+
+	delete [] data;
+
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	return true;
+}
+
+void Renderer::setAnimation(int handle)
+{
+	currentAnimation = handle;
+	animationTime = 0;
+}
@@ -0,0 +1,204 @@
+#ifndef RENDERER_HPP
+#define RENDERER_HPP
+
+#include "algebra.hpp"
+#include "game.hpp"
+#include "engine.hpp"
+#include "particle.hpp"
+#include "glstate.hpp"
+#include "animation.hpp"
+#include <vector>
+#include <GL/gl.h>
+#include <GL/glu.h>
+
+#define NUM_TEXTURES	9
+
+// Draws the game. Everything here only talks to GL, never to GTK, so the
+// window and the offscreen benchmark and golden harnesses share it; all
+// of it needs the caller to have a context current.
+class Renderer {
+public:
+	Renderer();
+
+	enum DrawMode {
+		WIRE,
+		FACE,
+		MULTICOLOURED
+	};
+
+	// Bits for setRenderOptions
+	enum RenderOption {
+		TEXTURES		= 1,
+		BUMP_MAPPING	= 2,
+		TRANSLUCENCY	= 4,
+		SHADOWS			= 8,
+		MOTION_BLUR		= 16
+	};
+
+	// Buttons on the start screen
+	enum StartButton {
+		NO_BUTTON,
+		PLAY_BUTTON,
+		SOUND_BUTTON,
+		SINGLE_SKIN_BUTTON
+	};
+
+	void initGL();
+	void resizeGL(int width, int height);
+	void renderFrame();
+
+	void setDrawMode(DrawMode newDrawMode);
+	void setRenderOptions(int options);
+	int getRenderOptions() const;
+
+	// The game to draw, which the caller keeps valid until the next call
+	void setSnapshot(const GameSnapshot *newSnapshot);
+
+	// Particles, level skins and the mascot's mood for something that
+	// happened in the game
+	void gameEvent(const GameEvent &event);
+
+	// Back to the neutral face and the first level's skins
+	void resetScene();
+
+	// The start screen button under window position x, y, shown pressed
+	StartButton pickStartScreen(int x, int y);
+
+	// Whether anything keeps moving when the game doesn't
+	bool particlesMoving() const;
+	bool mascotMoving() const;
+
+	// Count a frame begun at frameStart, and print the frame statistics
+	// once a second when showProfile is set
+	void updateProfile(double frameStart);
+
+	// The camera. The scene is scaled, turned about x and then y and slid
+	// along x by rotationAngleZ. Axes with spin set turn by rotationSpeed
+	// every frame.
+	double rotationAngleX, rotationAngleY, rotationAngleZ;
+	double rotationSpeed;
+	bool spinX, spinY, spinZ;
+	double scaleFactor;
+	float lightPos[4];
+
+	// Draw the start screen rather than the game
+	bool startScreen;
+
+	// Keep the first level's skins
+	bool singleSkinMode;
+
+	bool showProfile;
+
+	void makeRasterFont();
+	void printString(const char *s);
+	void addParticleBox(float x, float y, int colour);
+	void addFireworks(float x, float y);
+
+	// Texture mapping stuff
+	/* storage for one texture  */
+	int numTextures;
+	GLuint *texture;
+
+	/* Image type - contains height, width, and data */
+	struct Image {
+	    unsigned long sizeX;
+	    unsigned long sizeY;
+	    char *data;
+	};
+	typedef struct Image Image;
+
+	int ImageLoad(const char *filename, Image *image);
+	int LoadGLTextures(const char *filename, GLuint &texid);
+	void setLevelTextures(int level);
+	void useTexture(GLuint texId);
+
+	// Bump mapping stuff
+	int GenNormalizationCubeMap(unsigned int size, GLuint &texid);
+	void setAnimation(int handle);
+
+private:
+	void drawGameboard(bool draw3D = true);
+	int cellColour(int row, int col, float &y);
+	void drawScene();
+	void drawBar();
+	void drawFallingBox();
+	void drawFloor();
+	void drawShadowVolumes();
+	void drawShadowCube(float y, float x, GLenum mode);
+	void drawRoom();
+	void drawStartScreen(bool picking);
+	void drawParticles(bool step = true);
+	void drawGrid();
+	void drawReflections();
+	void drawMoveBlur(int side); // 0 = right | 1 = left
+	void drawBackground();
+	void drawAnimatables();
+	void drawCube(float y, float x, int colourId, GLenum mode, bool draw3D = true);
+	int lightSphereLod();
+	void drawBumpCube(float y, float x, int colourId, bool draw3D = true);
+	void beginBumpMapping();
+	void endBumpMapping();
+
+	// A run of vertices in the static geometry buffer
+	struct GeometryRange {
+		GLenum mode;
+		GLint first;
+		GLsizei count;
+		bool normals;
+	};
+	void bakeStaticGeometry(int width, int height);
+	void beginStaticGeometry();
+	void drawStaticGeometry(const GeometryRange &range);
+
+	DrawMode currentDrawMode;
+
+	// The latest snapshot of the game, see setSnapshot
+	const GameSnapshot *snapshot;
+
+	int activeTextureId;
+
+	bool loadTexture;
+	bool loadBumpMapping;
+	bool transluceny;
+	GLuint square;
+	float shadowProj[16];
+
+	// Height of the viewport, as last passed to resizeGL
+	int viewHeight;
+
+	float planeNormal[4];
+	bool drawingShadow;
+	GLuint cube, bumpMap, floorTexId, playButtonTex, playButtonClickedTex, backgroundTex;
+	GLuint soundOnTex, soundOffTex, singleSkinModeTex, singleSkinModeClickedTex;
+	GLuint sphereDisplayList, texCubeDisplayList, outlineDisplayList, reflectCubeDisplayList;
+	GLuint lightSphereDisplayList;
+
+	// GLSL normal mapping, 0 if we have to use the combiner path
+	GLuint bumpProgram, bumpCubeDisplayList;
+	GLint bumpLightUniform;
+
+	// Background, floor, grid, clear bar and room, baked in initGL
+	GLuint staticGeometryBuffer;
+	GeometryRange backgroundRange, floorRange, gridLinesRange, gridDotsRange, gridBorderRange, barRange, roomRange;
+
+	// Skips redundant enables, texture binds and blend funcs
+	GLStateCache glState;
+
+	// Frame statistics for showProfile
+	int profileFrames;
+	double profileStart, profileFrameTime;
+	GLuint levelTextures[NUM_TEXTURES][4];
+	std::vector< std::pair<Point3D, Point3D> > silhouette;
+	std::vector< Particle *> particles;
+	bool motionBlur;
+	bool levelUpAnimation;
+	bool drawShadow;
+
+	// The mascot's moods, which one is showing and for how many frames
+	AnimationCache animations;
+	int neutralAnimation, happyAnimation, sadAnimation;
+	int currentAnimation;
+	float animationTime;
+};
+
+#endif
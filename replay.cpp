@@ -0,0 +1,87 @@
+#include "replay.hpp"
+#include "game.hpp"
+#include <fstream>
+
+Replay::Replay()
+	: seed(0)
+{
+}
+
+void Replay::clear(unsigned int newSeed)
+{
+	seed = newSeed;
+	events.clear();
+}
+
+void Replay::record(int tick, int action)
+{
+	Event e;
+	e.tick = tick;
+	e.action = action;
+	events.push_back(e);
+}
+
+void Replay::generate(int ticks)
+{
+	// Moves every few ticks, drawn from their own generator so that the
+	// sequence doesn't depend on the game's
+	unsigned int state = 12345;
+	clear(1);
+	for (int tick = 0;tick<ticks;tick++)
+	{
+		state = state * 1103515245 + 12345;
+		int r = (state >> 16) & 0x7fff;
+		if (r % 3 == 0)
+			record(tick, (r / 3) % NUM_ACTIONS);
+	}
+}
+
+bool Replay::load(const char *filename)
+{
+	std::ifstream file(filename);
+	if (!file.is_open())
+		return false;
+		
+	events.clear();
+	if (!(file >> seed))
+		return false;
+	
+	Event e;
+	while (file >> e.tick >> e.action)
+	{
+		if (e.action < 0 || e.action >= NUM_ACTIONS)
+			return false;
+		events.push_back(e);
+	}
+	return true;
+}
+
+bool Replay::save(const char *filename) const
+{
+	std::ofstream file(filename);
+	if (!file.is_open())
+		return false;
+		
+	file << seed << "\n";
+	for (unsigned int i = 0;i<events.size();i++)
+		file << events[i].tick << " " << events[i].action << "\n";
+	return file.good();
+}
+
+bool applyAction(Game *game, int action)
+{
+	switch (action)
+	{
+		case ACTION_LEFT:
+			return game->moveLeft();
+		case ACTION_RIGHT:
+			return game->moveRight();
+		case ACTION_ROTATE_CCW:
+			return game->rotateCCW();
+		case ACTION_ROTATE_CW:
+			return game->rotateCW();
+		case ACTION_DROP:
+			return game->drop();
+	}
+	return false;
+}
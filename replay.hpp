@@ -0,0 +1,51 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include <vector>
+
+#include "game.hpp"
+
+// The moves a player can make, in the order they are handled by
+// Viewer::on_key_press_event
+enum Action {
+	ACTION_LEFT,
+	ACTION_RIGHT,
+	ACTION_ROTATE_CCW,
+	ACTION_ROTATE_CW,
+	ACTION_DROP,
+	NUM_ACTIONS
+};
+
+// A recorded game: the seed the game was reset with, and every move along
+// with the number of game ticks that had passed when it was made.
+//
+// On disk this is a text file with the seed on the first line followed by
+// one "tick action" pair per line.
+class Replay
+{
+	public:
+		struct Event {
+			int tick;
+			int action;
+		};
+		
+		Replay();
+		
+		bool load(const char *filename);
+		bool save(const char *filename) const;
+		
+		void clear(unsigned int newSeed);
+		void record(int tick, int action);
+		
+		// Replace this replay with a fixed pseudo random sequence of moves
+		// over the given number of ticks, the same on every machine
+		void generate(int ticks);
+		
+		unsigned int seed;
+		std::vector<Event> events;
+};
+
+// Perform a single move on the game. Returns whether anything happened.
+bool applyAction(Game *game, int action);
+
+#endif
@@ -0,0 +1,63 @@
+#include "shader.hpp"
+#include <iostream>
+#include <cstdlib>
+
+bool shadersSupported()
+{
+	const char *version = (const char *)glGetString(GL_VERSION);
+	if (version == NULL)
+		return false;
+	return atoi(version) >= 2;
+}
+
+static GLuint compileShader(GLenum type, const char *source)
+{
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+	
+	GLint status;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (!status)
+	{
+		char log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		std::cerr << "Error compiling shader:\n" << log << std::endl;
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+GLuint buildProgram(const char *vertexSource, const char *fragmentSource)
+{
+	GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+	GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+	if (!vertexShader || !fragmentShader)
+	{
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+		return 0;
+	}
+	
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glLinkProgram(program);
+	
+	// The program keeps the shaders alive for as long as it needs them
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+	
+	GLint status;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (!status)
+	{
+		char log[1024];
+		glGetProgramInfoLog(program, sizeof(log), NULL, log);
+		std::cerr << "Error linking program:\n" << log << std::endl;
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
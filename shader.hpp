@@ -0,0 +1,13 @@
+#ifndef SHADER_HPP
+#define SHADER_HPP
+
+#include <GL/gl.h>
+
+// Returns true if the current context can run GLSL programs (OpenGL 2.0)
+bool shadersSupported();
+
+// Compile and link a GLSL program from vertex and fragment shader source.
+// Returns 0 (and prints the info log) if anything fails to compile or link.
+GLuint buildProgram(const char *vertexSource, const char *fragmentSource);
+
+#endif
@@ -0,0 +1,91 @@
+#include "threadpool.hpp"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int numThreads)
+	: job(NULL)
+	, count(0)
+	, generation(0)
+	, busy(0)
+	, stopping(false)
+	, nextItem(0)
+{
+	if (numThreads <= 0)
+		numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	for (int i = 1;i<numThreads;i++)
+		threads.push_back(std::thread(&ThreadPool::work, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (unsigned int i = 0;i<threads.size();i++)
+		threads[i].join();
+}
+
+int ThreadPool::size() const
+{
+	return threads.size() + 1;
+}
+
+void ThreadPool::run(int newCount, const std::function<void(int, int)> &newJob)
+{
+	if (threads.empty() || newCount <= 1)
+	{
+		for (int i = 0;i<newCount;i++)
+			newJob(i, 0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &newJob;
+		count = newCount;
+		nextItem = 0;
+		busy = threads.size();
+		generation++;
+	}
+	wake.notify_all();
+
+	workOnBatch(0);
+
+	// Workers still finishing their last item hold on to the job
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [this] { return busy == 0; });
+	job = NULL;
+}
+
+void ThreadPool::workOnBatch(int worker)
+{
+	for (int item = nextItem++;item<count;item = nextItem++)
+		(*job)(item, worker);
+}
+
+void ThreadPool::work(int worker)
+{
+	unsigned int seen = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return stopping || generation != seen; });
+			if (stopping)
+				return;
+			seen = generation;
+		}
+
+		workOnBatch(worker);
+
+		bool last;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			last = --busy == 0;
+		}
+		if (last)
+			finished.notify_one();
+	}
+}
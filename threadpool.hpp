@@ -0,0 +1,51 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of threads sharing out batches of work. The thread that
+// hands a batch over works on it too, so a pool of one thread has no
+// threads of its own and just runs everything in place.
+class ThreadPool
+{
+	public:
+		// 0 means one thread per processor
+		ThreadPool(int threads = 0);
+		~ThreadPool();
+
+		// Threads working on each batch, counting the caller
+		int size() const;
+
+		// Call job(item, worker) for every item below count and wait until
+		// they have all returned. Worker is below size(), and no two calls
+		// with the same worker run at once, so it can pick out scratch
+		// space. Only one batch can run at a time.
+		void run(int count, const std::function<void(int item, int worker)> &job);
+
+	private:
+		ThreadPool(const ThreadPool &);
+		ThreadPool &operator =(const ThreadPool &);
+
+		void work(int worker);
+		void workOnBatch(int worker);
+
+		std::vector<std::thread> threads;
+
+		// The batch being worked on. Each new batch bumps the generation
+		// to wake the workers.
+		std::mutex mutex;
+		std::condition_variable wake, finished;
+		const std::function<void(int, int)> *job;
+		int count;
+		unsigned int generation;
+		int busy;
+		bool stopping;
+		std::atomic<int> nextItem;
+};
+
+#endif
@@ -0,0 +1,38 @@
+#include "transposition.hpp"
+#include <cstring>
+
+TranspositionTable::TranspositionTable(int bits)
+	: slots(1ull << bits)
+	, mask((1ull << bits) - 1)
+{
+	clear();
+}
+
+bool TranspositionTable::find(unsigned long long hash, double &score) const
+{
+	const Slot &slot = slots[hash & mask];
+	unsigned long long bits = slot.score.load(std::memory_order_relaxed);
+	if ((slot.check.load(std::memory_order_relaxed) ^ bits) != hash)
+		return false;
+	memcpy(&score, &bits, sizeof(score));
+	return true;
+}
+
+void TranspositionTable::store(unsigned long long hash, double score)
+{
+	unsigned long long bits;
+	memcpy(&bits, &score, sizeof(bits));
+	Slot &slot = slots[hash & mask];
+	slot.score.store(bits, std::memory_order_relaxed);
+	slot.check.store(hash ^ bits, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear()
+{
+	// An empty slot matches hash 0, which a game never hashes to in practice
+	for (unsigned int i = 0;i<slots.size();i++)
+	{
+		slots[i].score.store(0, std::memory_order_relaxed);
+		slots[i].check.store(0, std::memory_order_relaxed);
+	}
+}
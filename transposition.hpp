@@ -0,0 +1,37 @@
+#ifndef TRANSPOSITION_HPP
+#define TRANSPOSITION_HPP
+
+#include <atomic>
+#include <vector>
+
+// Scores remembered by game hash, for searches that reach the same game
+// more than once. The table never grows: each hash has one slot, and a
+// new score for a hash takes the slot over from whatever was there.
+//
+// Any number of threads can use the table at once without locking. A slot
+// holds the score and the hash XORed with the score, so a slot that two
+// threads wrote at the same moment just won't match either hash rather
+// than giving one of them the other's score.
+class TranspositionTable
+{
+	public:
+		// 2^bits slots
+		TranspositionTable(int bits = 16);
+
+		// False if there is no score for hash
+		bool find(unsigned long long hash, double &score) const;
+		void store(unsigned long long hash, double score);
+
+		void clear();
+
+	private:
+		struct Slot {
+			std::atomic<unsigned long long> check;
+			std::atomic<unsigned long long> score;
+		};
+
+		std::vector<Slot> slots;
+		unsigned long long mask;
+};
+
+#endif
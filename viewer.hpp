@@ -1,25 +1,20 @@
 #ifndef CS488_VIEWER_HPP
 #define CS488_VIEWER_HPP
 
-#include "algebra.hpp"
 #include <gtkmm.h>
 #include <gtkglmm.h>
 #include "game.hpp"
 #include "SoundManager.hpp"
-#include <map>
-#include <vector>
-#include "particle.hpp"
-#include <GL/glu.h>
-// The "main" OpenGL widget
+#include "engine.hpp"
+#include "renderer.hpp"
+#include <string>
+
+// The "main" OpenGL widget. Drawing is done by the renderer; the widget
+// runs the game, handles input and decides when to redraw.
 class Viewer : public Gtk::GL::DrawingArea {
 public:
 	Viewer();
 	virtual ~Viewer();
-	enum DrawMode {
-		WIRE,
-		FACE,
-		MULTICOLOURED
-	};
 	
 	enum Speed {
 		SLOW,
@@ -32,10 +27,19 @@ public:
 	// directly. Instead call this, which will cause an on_expose_event
 	// call when the time is right.
 	void invalidate();
-	void setDrawMode(DrawMode newDrawMode);
 	
-	void setRotationAngle (int angle);
-	int getRotationAngle();
+	// Why the next frame has to be drawn. Timers skip the redraw while
+	// none of these apply.
+	enum DirtyReason {
+		DIRTY_BOARD		= 1,
+		DIRTY_CLEAR_BAR	= 2,
+		DIRTY_PARTICLES	= 4,
+		DIRTY_ANIMATION	= 8,
+		DIRTY_CAMERA	= 16,
+		DIRTY_VIEW		= 32
+	};
+	void markDirty(unsigned int reasons);
+	void setDrawMode(Renderer::DrawMode newDrawMode);
 	
 	void startScale();
 	void endScale();
@@ -43,8 +47,15 @@ public:
 	void setSpeed(Speed newSpeed);
 	
 	void toggleBuffer();
-
-	bool gameTick();
+	
+	// Start a game whose pieces are generated from seed
+	void startGame(unsigned int seed);
+	void performAction(int action);
+	bool isGameOver();
+	
+	// Record every game to this file, written when the game ends
+	void setRecordFile(const std::string &filename);
+	void saveReplay();
 		
 	virtual bool on_key_press_event( GdkEventKey *ev );
 		
@@ -57,36 +68,11 @@ public:
 	void toggleMotionBlur();
 	void toggleSound();
 	void toggleShadows();
-	void makeRasterFont();
-	void printString(const char *s);
+	void toggleProfile();
 	
 	void setScoreWidgets(Gtk::Label *score, Gtk::Label *linesCleared);
-	bool moveClearBar();
 	void pauseGame();
-	void addParticleBox(float x, float y, int colour);
-	void addFireworks(float x, float y);
-
-
-	// Texture mapping stuff	
-	/* storage for one texture  */
-	int numTextures;
-	GLuint *texture;
-
-	/* Image type - contains height, width, and data */
-	struct Image {
-	    unsigned long sizeX;
-	    unsigned long sizeY;
-	    char *data;
-	};
-	typedef struct Image Image;
-	
-	int ImageLoad(const char *filename, Image *image);
-	int LoadGLTextures(const char *filename, GLuint &texid);
-
-	// Bump mapping stuff	
-	int GenNormalizationCubeMap(unsigned int size, GLuint &texid);
-	void readFile(char *filename);
-	bool forceRender();
+	bool redrawIfDirty();
 	
 protected:
 
@@ -112,31 +98,9 @@ protected:
 
 
 private:
-	void drawGameboard(bool draw3D = true);
-	void drawScene();
-	void drawBar();
-	void drawFallingBox();
-	void drawFloor();
-	void drawShadowVolumes();
-	void drawShadowCube(float y, float x, GLenum mode);
-	void drawRoom();
-	void drawStartScreen(bool picking);
-	void drawParticles(bool step = true);
-	void drawGrid();
-	void drawReflections();
-	void drawMoveBlur(int side); // 0 = right | 1 = left
-	void drawBackground();
-	void drawAnimatables();	
-	void drawCube(float y, float x, int colourId, GLenum mode, bool draw3D = true);
-	void drawBumpCube(float y, float x, int colourId, bool draw3D = true);
-	
-	DrawMode currentDrawMode;
-	
-	// The angle at which we are currently rotated
-	double rotationAngleX, rotationAngleY, rotationAngleZ;
-
-	// How fast we are rotating the window
-	double rotationSpeed;
+	unsigned int ongoingChanges();
+	
+	Renderer renderer;
 	
 	// Flags to denote which mouse buttons are down
 	bool mouseB1Down, mouseB2Down, mouseB3Down;
@@ -144,10 +108,6 @@ private:
 	// Flags to denote which axis to rotate around after mouse up event
 	bool rotateAboutX, rotateAboutY, rotateAboutZ;
 	
-	// What factor we are scaling the game by currently
-	double scaleFactor;
-	
-	
 	Point2D startPos, mouseDownPos, startScalePos, endScalePos;
 	
 	// Flag used to denote that the shift key is held down
@@ -156,8 +116,8 @@ private:
 	// Flag that determines when to use doubleBuffer
 	bool doubleBuffer;
 	
-	// Timer used to call the tick method
-	sigc::connection tickTimer, clearBarTimer, gameOverAnimTimer;
+	// Timer used to keep the game over animation going
+	sigc::connection gameOverAnimTimer;
 	
 	// Timer for rotate
 	sigc::connection rotateTimer;
@@ -174,63 +134,39 @@ private:
 	// Speed value set by menu
 	Speed speed;
 	
-	// Pointer to the actual game
-	Game *game;
+	// The game runs in the engine. Drawing only ever reads the latest
+	// snapshot of it, picked up in engineUpdated.
+	GameEngine engine;
+	const GameSnapshot *snapshot;
+	double lastClearBarPos;
+	Glib::Dispatcher engineDispatcher;
+	void engineUpdated();
+	
+	// Left on the start screen for a while, the bot plays a demo game
+	// until a key is pressed or the mouse clicked
+	AiPlayer demoPlayer;
+	bool demo;
+	sigc::connection idleTimer;
+	bool startDemo();
+	void stopDemo();
 	
 	// Game over flag
 	bool gameOver;
 	
-	// Lighting flag
-	bool lightingFlag;
-		
+	// DirtyReason bits collected since the last frame
+	unsigned int dirty;
+	
 	// Label widgets
 	Gtk::Label *scoreLabel, *linesClearedLabel;
 	
-	// Boot screen
-	bool loadScreen;
-	
-	int activeTextureId;
-	
-	bool loadTexture;
-	bool loadBumpMapping;
-	bool transluceny;
 	SoundManager sm;
 	int backgroundMusic;
 	int turnSound;
 	int moveSound;
 	int introMusic;
-	GLuint square;
-	float shadowProj[16];
-	float lightPos[4];
-	
-	float planeNormal[4];
-	bool drawingShadow;
-	GLuint cube, bumpMap, floorTexId, playButtonTex, playButtonClickedTex, backgroundTex;
-	GLuint soundOnTex, soundOffTex, singleSkinModeTex, singleSkinModeClickedTex;
-	GLuint sphereDisplayList, texCubeDisplayList, outlineDisplayList, reflectCubeDisplayList;
 	bool clickedButton;
-	std::vector< std::pair<Point3D, Point3D> > silhouette;
-	std::vector< Particle *> particles;
-	bool moveLeft;
-	bool moveRight;
 	bool moveLightSource;
-	bool motionBlur;
-	bool levelUpAnimation;
 	bool disableSound;
-	bool singleSkinMode;
-	bool drawShadow;
-	GLUquadricObj *particleSphere;	
-	
-	struct Animatable{
-		std::vector<Point3D> frames;
-		std::vector<float *> scales;
-		std::vector<float *> rotates;
-		int shapeType;	
-		bool loop;
-		float *col;
-	};
-	
-	std::vector<Animatable> animatables;
 };
 
 #endif